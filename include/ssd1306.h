@@ -47,6 +47,16 @@ extern "C"
 {
 #endif /* __cplusplus */
 
+  struct mgos_ssd1306;
+  struct mgos_ssd1306_dlist;
+  struct mgos_ssd1306_widget;
+  struct mgos_ssd1306_textfield;
+  struct mgos_ssd1306_ticker;
+  struct mgos_ssd1306_layer;
+  struct mgos_ssd1306_gray;
+  struct mgos_ssd1306_anim;
+  struct mgos_ssd1306_canvas;
+  struct mgos_ssd1306_screen;
 
   typedef enum
   {
@@ -56,6 +66,52 @@ extern "C"
     SSD1306_COLOR_INVERT = 2,   //< Invert pixel (XOR)
   } mgos_ssd1306_color_t;
 
+  typedef enum
+  {
+    SSD1306_ALIGN_LEFT = 0,
+    SSD1306_ALIGN_CENTER = 1,
+    SSD1306_ALIGN_RIGHT = 2,
+  } mgos_ssd1306_align_t;
+
+// Most values per strip chart sample, see mgos_ssd1306_chart_create()
+#define SSD1306_CHART_MAX_SERIES 4
+
+  typedef enum
+  {
+    SSD1306_DITHER_THRESHOLD = 0,       //< White from level 128 up
+    SSD1306_DITHER_ORDERED = 1, //< 4x4 Bayer matrix
+    SSD1306_DITHER_FLOYD_STEINBERG = 2, //< Error diffusion
+  } mgos_ssd1306_dither_t;
+
+  typedef enum
+  {
+    SSD1306_QR_ECC_LOW = 0,     //< Recovers 7% of the code
+    SSD1306_QR_ECC_MEDIUM = 1,  //< 15%
+    SSD1306_QR_ECC_QUARTILE = 2,        //< 25%
+    SSD1306_QR_ECC_HIGH = 3,    //< 30%
+  } mgos_ssd1306_qr_ecc_t;
+
+  typedef enum
+  {
+    SSD1306_ROP_COPY = 0,       //< dst = src
+    SSD1306_ROP_OR = 1, //< dst |= src
+    SSD1306_ROP_AND = 2,        //< dst &= src
+    SSD1306_ROP_XOR = 3,        //< dst ^= src
+    SSD1306_ROP_NOT = 4,        //< dst = ~src
+  } mgos_ssd1306_rop_t;
+
+  // Fills pixels with the 8-bit gray values of an image row; returning false stops drawing
+  typedef bool (*mgos_ssd1306_image_row_cb_t) (uint16_t row, uint8_t *pixels, void *arg);
+
+  // Draws the changing parts of a cached screen, see mgos_ssd1306_screen_show()
+  typedef void (*mgos_ssd1306_screen_cb_t) (struct mgos_ssd1306 *oled, void *arg);
+
+  typedef struct
+  {
+    int16_t x;
+    int16_t y;
+  } mgos_ssd1306_point_t;
+
   /**
    * @brief Access the SSD1306 driver handle that is set up via sysconfig.
    *
@@ -83,7 +139,7 @@ extern "C"
   void mgos_ssd1306_close (struct mgos_ssd1306 *oled);
 
   /**
-   * @brief Get screen width.
+   * @brief Get screen width, as seen by drawing: the panel height in portrait mode.
    *
    * @param oled SSD1306 driver handle
    *
@@ -92,7 +148,7 @@ extern "C"
   uint8_t mgos_ssd1306_get_width (struct mgos_ssd1306 *oled);
 
   /**
-   * @brief Get screen height
+   * @brief Get screen height, as seen by drawing: the panel width in portrait mode.
    *
    * @param oled SSD1306 driver handle
    *
@@ -101,18 +157,88 @@ extern "C"
   uint8_t mgos_ssd1306_get_height (struct mgos_ssd1306 *oled);
 
   /**
-   * @brief Clear the screen bitmap.
+   * @brief Get drawing canvas width. The canvas is at least as large as the screen;
+   * drawing primitives use canvas coordinates.
+   *
+   * @param oled SSD1306 driver handle
+   *
+   * @return Canvas width, in pixels.
+   */
+  uint16_t mgos_ssd1306_get_canvas_width (struct mgos_ssd1306 *oled);
+
+  /**
+   * @brief Get drawing canvas height.
+   *
+   * @param oled SSD1306 driver handle
+   *
+   * @return Canvas height, in pixels.
+   */
+  uint16_t mgos_ssd1306_get_canvas_height (struct mgos_ssd1306 *oled);
+
+  /**
+   * @brief Move the screen viewport over the canvas. The position is clamped so
+   * the viewport stays inside the canvas; the next refresh resends the whole screen.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Canvas X coordinate shown at the left edge of the screen.
+   * @param y Canvas Y coordinate shown at the top edge of the screen.
+   */
+  void mgos_ssd1306_set_viewport (struct mgos_ssd1306 *oled, int16_t x, int16_t y);
+
+  /**
+   * @brief Get canvas X coordinate of the viewport.
+   *
+   * @param oled SSD1306 driver handle
+   *
+   * @return Viewport left edge, in canvas pixels.
+   */
+  int16_t mgos_ssd1306_get_viewport_x (struct mgos_ssd1306 *oled);
+
+  /**
+   * @brief Get canvas Y coordinate of the viewport.
+   *
+   * @param oled SSD1306 driver handle
+   *
+   * @return Viewport top edge, in canvas pixels.
+   */
+  int16_t mgos_ssd1306_get_viewport_y (struct mgos_ssd1306 *oled);
+
+  /**
+   * @brief Restrict drawing to a rectangle of the canvas. Drawing primitives leave
+   * everything outside of it untouched. The rectangle is clipped to the canvas.
+   * While a display list is recorded, clip changes are recorded along with the drawing.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Left edge, canvas coordinates.
+   * @param y Top edge, canvas coordinates.
+   * @param w Width.
+   * @param h Height.
+   */
+  void mgos_ssd1306_set_clip (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h);
+
+  /**
+   * @brief Allow drawing on the whole canvas again.
+   *
+   * @param oled SSD1306 driver handle.
+   */
+  void mgos_ssd1306_reset_clip (struct mgos_ssd1306 *oled);
+
+  /**
+   * @brief Clear the canvas bitmap. Without a frame buffer this empties the display
+   * list the screen is rendered from.
    *
    * @param oled SSD1306 driver handle.
    */
   void mgos_ssd1306_clear (struct mgos_ssd1306 *oled);
 
   /**
-   * @brief Refresh the display, sending any dirty regions to the OLED controller for display.
-   * Call this after you are finished calling any drawing primitives.
+   * @brief Refresh the display, sending any dirty regions inside the viewport to the OLED
+   * controller for display. Call this after you are finished calling any drawing primitives.
+   * Without a frame buffer, the pages that changed since the last refresh are rendered
+   * and sent one at a time.
    *
    * @param oled SSD1306 driver handle.
-   * @param force Redraw the entire bitmap, not just dirty regions.
+   * @param force Redraw the entire viewport, not just dirty regions.
    */
   void mgos_ssd1306_refresh (struct mgos_ssd1306 *oled, bool force);
 
@@ -124,9 +250,21 @@ extern "C"
    * @param y Y coordinate.
    * @param color Pixel color.
    */
-  void mgos_ssd1306_draw_pixel (struct mgos_ssd1306 *oled, int8_t x, int8_t y,
+  void mgos_ssd1306_draw_pixel (struct mgos_ssd1306 *oled, int16_t x, int16_t y,
                                 mgos_ssd1306_color_t color);
 
+  /**
+   * @brief Draw a batch of pixels. Pixels outside the canvas are skipped and the
+   * dirty region is updated once for the whole batch.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param points Array of pixel coordinates.
+   * @param count Number of pixels.
+   * @param color Pixel color.
+   */
+  void mgos_ssd1306_draw_pixels (struct mgos_ssd1306 *oled, const mgos_ssd1306_point_t *points, uint16_t count,
+                                 mgos_ssd1306_color_t color);
+
   /**
    * @brief Draw a horizontal line.
    *
@@ -136,7 +274,7 @@ extern "C"
    * @param w Line length.
    * @param color Line color.
    */
-  void mgos_ssd1306_draw_hline (struct mgos_ssd1306 *oled, int8_t x, int8_t y, uint8_t w,
+  void mgos_ssd1306_draw_hline (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w,
                                 mgos_ssd1306_color_t color);
 
   /**
@@ -148,9 +286,33 @@ extern "C"
    * @param h Line length.
    * @param color Line color.
    */
-  void mgos_ssd1306_draw_vline (struct mgos_ssd1306 *oled, int8_t x, int8_t y, uint8_t h,
+  void mgos_ssd1306_draw_vline (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t h,
                                 mgos_ssd1306_color_t color);
 
+  /**
+   * @brief Draw a straight line between two points. The line is clipped to the canvas.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x0 Start X coordinate.
+   * @param y0 Start Y coordinate.
+   * @param x1 End X coordinate.
+   * @param y1 End Y coordinate.
+   * @param color Line color.
+   */
+  void mgos_ssd1306_draw_line (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                               mgos_ssd1306_color_t color);
+
+  /**
+   * @brief Draw connected line segments through a list of points.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param points Array of vertices.
+   * @param count Number of vertices.
+   * @param color Line color.
+   */
+  void mgos_ssd1306_draw_polyline (struct mgos_ssd1306 *oled, const mgos_ssd1306_point_t *points, uint16_t count,
+                                   mgos_ssd1306_color_t color);
+
   /**
    * @brief Draw an unfilled rectangle.
    *
@@ -161,7 +323,7 @@ extern "C"
    * @param h Rectangle height.
    * @param color Line color.
    */
-  void mgos_ssd1306_draw_rectangle (struct mgos_ssd1306 *oled, int8_t x, int8_t y, uint8_t w, uint8_t h,
+  void mgos_ssd1306_draw_rectangle (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
                                     mgos_ssd1306_color_t color);
 
   /**
@@ -174,9 +336,36 @@ extern "C"
    * @param h Rectangle height.
    * @param color Line and fill color.
    */
-  void mgos_ssd1306_fill_rectangle (struct mgos_ssd1306 *oled, int8_t x, int8_t y, uint8_t w, uint8_t h,
+  void mgos_ssd1306_fill_rectangle (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
                                     mgos_ssd1306_color_t color);
 
+  /**
+   * @brief Draw a filled polygon. Self-intersecting and concave polygons are filled
+   * with the even-odd rule; the fill includes the polygon outline.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param points Array of vertices; the last vertex connects back to the first.
+   * @param count Number of vertices.
+   * @param color Fill color.
+   */
+  void mgos_ssd1306_fill_polygon (struct mgos_ssd1306 *oled, const mgos_ssd1306_point_t *points, uint16_t count,
+                                  mgos_ssd1306_color_t color);
+
+  /**
+   * @brief Draw a filled triangle.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x0 First vertex X coordinate.
+   * @param y0 First vertex Y coordinate.
+   * @param x1 Second vertex X coordinate.
+   * @param y1 Second vertex Y coordinate.
+   * @param x2 Third vertex X coordinate.
+   * @param y2 Third vertex Y coordinate.
+   * @param color Fill color.
+   */
+  void mgos_ssd1306_fill_triangle (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                                   int16_t x2, int16_t y2, mgos_ssd1306_color_t color);
+
   /**
    * @brief Draw an unfilled circle.
    *
@@ -186,7 +375,7 @@ extern "C"
    * @param r Radius.
    * @param color Line color.
    */
-  void mgos_ssd1306_draw_circle (struct mgos_ssd1306 *oled, int8_t x0, int8_t y0, uint8_t r, mgos_ssd1306_color_t color);
+  void mgos_ssd1306_draw_circle (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, uint16_t r, mgos_ssd1306_color_t color);
 
   /**
    * @brief Draw a filled circle.
@@ -197,7 +386,78 @@ extern "C"
    * @param r Radius.
    * @param color Line and fill color.
    */
-  void mgos_ssd1306_fill_circle (struct mgos_ssd1306 *oled, int8_t x0, int8_t y0, uint8_t r, mgos_ssd1306_color_t color);
+  void mgos_ssd1306_fill_circle (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, uint16_t r, mgos_ssd1306_color_t color);
+
+  /**
+   * @brief Draw an unfilled ellipse.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x0 Center X coordinate.
+   * @param y0 Center Y coordinate.
+   * @param rx Horizontal radius.
+   * @param ry Vertical radius.
+   * @param color Line color.
+   */
+  void mgos_ssd1306_draw_ellipse (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, uint16_t rx, uint16_t ry,
+                                  mgos_ssd1306_color_t color);
+
+  /**
+   * @brief Draw a filled ellipse.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x0 Center X coordinate.
+   * @param y0 Center Y coordinate.
+   * @param rx Horizontal radius.
+   * @param ry Vertical radius.
+   * @param color Line and fill color.
+   */
+  void mgos_ssd1306_fill_ellipse (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, uint16_t rx, uint16_t ry,
+                                  mgos_ssd1306_color_t color);
+
+  /**
+   * @brief Draw an unfilled rectangle with rounded corners.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x X coordinate.
+   * @param y Y coordinate.
+   * @param w Rectangle width.
+   * @param h Rectangle height.
+   * @param r Corner radius; limited to half of the shorter side.
+   * @param color Line color.
+   */
+  void mgos_ssd1306_draw_round_rectangle (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                          uint16_t r, mgos_ssd1306_color_t color);
+
+  /**
+   * @brief Draw a filled rectangle with rounded corners.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x X coordinate.
+   * @param y Y coordinate.
+   * @param w Rectangle width.
+   * @param h Rectangle height.
+   * @param r Corner radius; limited to half of the shorter side.
+   * @param color Line and fill color.
+   */
+  void mgos_ssd1306_fill_round_rectangle (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                          uint16_t r, mgos_ssd1306_color_t color);
+
+  /**
+   * @brief Draw a circular arc of the given thickness. Angles are in degrees, 0 points
+   * right and angles grow clockwise; the arc runs clockwise from start to end.
+   * A thickness of at least the radius draws a pie slice.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x0 Center X coordinate.
+   * @param y0 Center Y coordinate.
+   * @param r Outer radius.
+   * @param start_angle Start angle in degrees.
+   * @param end_angle End angle in degrees; start + 360 draws a full ring.
+   * @param thickness Arc thickness in pixels, measured inwards from the outer radius.
+   * @param color Arc color.
+   */
+  void mgos_ssd1306_draw_arc (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, uint16_t r, int16_t start_angle,
+                              int16_t end_angle, uint16_t thickness, mgos_ssd1306_color_t color);
 
   /**
    * @brief Select active font ID.
@@ -219,9 +479,95 @@ extern "C"
    *
    * @return Character width in pixels
    */
-  uint8_t mgos_ssd1306_draw_char (struct mgos_ssd1306 *oled, uint8_t x, uint8_t y, unsigned char c,
+  uint8_t mgos_ssd1306_draw_char (struct mgos_ssd1306 *oled, int16_t x, int16_t y, unsigned char c,
                                   mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background);
 
+  /**
+   * @brief Draw a 1bpp bitmap. Rows are (w + 7) / 8 bytes long, the most significant
+   * bit is the leftmost pixel, as in the font glyphs.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x X coordinate.
+   * @param y Y coordinate.
+   * @param w Bitmap width.
+   * @param h Bitmap height.
+   * @param bitmap Bitmap rows.
+   * @param foreground Color of set bits.
+   * @param background Color of clear bits, SSD1306_COLOR_TRANSPARENT leaves them alone.
+   */
+  void mgos_ssd1306_draw_bitmap (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h, const uint8_t *bitmap,
+                                 mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background);
+
+  /**
+   * @brief Draw an 8-bit gray image (0 black, 255 white), dithered to the 1bpp canvas.
+   * Not available while a display list is recorded or in paged mode.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param w Image width.
+   * @param h Image height.
+   * @param pixels w * h gray values, row by row.
+   * @param dither Dithering method.
+   */
+  void mgos_ssd1306_draw_gray_image (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                     const uint8_t *pixels, mgos_ssd1306_dither_t dither);
+
+  /**
+   * @brief Like mgos_ssd1306_draw_gray_image(), with the rows supplied one at a time by
+   * a callback, top to bottom, so the image never needs to be in memory as a whole.
+   *
+   * @param cb Called with the row number and a buffer of w bytes to fill.
+   * @param arg Passed to cb.
+   */
+  void mgos_ssd1306_draw_gray_image_cb (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                        mgos_ssd1306_image_row_cb_t cb, void *arg, mgos_ssd1306_dither_t dither);
+
+  /**
+   * @brief Draw a monochrome image file: PBM (P1 or P4), XBM or uncompressed 1bpp BMP.
+   * The file is streamed in small chunks and drawn clipped, without loading it whole.
+   * Ink pixels (1 bits in PBM and XBM, the darker palette color in BMP) are drawn in the
+   * foreground color, the others in the background color. Not available while a
+   * display list is recorded or in paged mode.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param path File name.
+   * @param foreground Color of ink pixels.
+   * @param background Color of the other pixels, SSD1306_COLOR_TRANSPARENT leaves them alone.
+   *
+   * @return true if the whole image was drawn.
+   */
+  bool mgos_ssd1306_draw_image_file (struct mgos_ssd1306 *oled, int16_t x, int16_t y, const char *path,
+                                     mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background);
+
+  /**
+   * @brief Draw text as a QR code, in the smallest of versions 1 to 6 (21 to 41
+   * modules) that holds it, with a quiet zone of 2 modules. Dark modules are drawn
+   * black and light ones white, scale pixels square each, written directly into the
+   * frame buffer; this cannot be recorded in a display list. Version 6 holds up to
+   * 134 bytes at SSD1306_QR_ECC_LOW and 58 at SSD1306_QR_ECC_HIGH.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Left edge of the quiet zone.
+   * @param y Top edge of the quiet zone.
+   * @param text Text to encode, in byte mode.
+   * @param scale Pixels per module side.
+   * @param ecc Error correction level.
+   *
+   * @return Side of the code with its quiet zone in pixels, 0 if the text is too long.
+   */
+  uint16_t mgos_ssd1306_draw_qr (struct mgos_ssd1306 *oled, int16_t x, int16_t y, const char *text, uint8_t scale,
+                                 mgos_ssd1306_qr_ecc_t ecc);
+
+  /**
+   * @brief Side in pixels of the QR code mgos_ssd1306_draw_qr() would draw, e.g. to center it.
+   *
+   * @return Side with the quiet zone, 0 if the text is too long.
+   */
+  uint16_t mgos_ssd1306_measure_qr (const char *text, mgos_ssd1306_qr_ecc_t ecc, uint8_t scale);
+
   /**
    * @brief Draw a string using the active font and selected colors.
    *
@@ -234,8 +580,8 @@ extern "C"
    *
    * @return String witdth in pixels.
    */
-  uint8_t mgos_ssd1306_draw_string_color (struct mgos_ssd1306 *oled, uint8_t x, uint8_t y, const char *str,
-                                          mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background);
+  uint16_t mgos_ssd1306_draw_string_color (struct mgos_ssd1306 *oled, int16_t x, int16_t y, const char *str,
+                                           mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background);
 
   /**
    * @brief Draw a string using the active font and default colors (white on transparent)
@@ -247,7 +593,7 @@ extern "C"
    *
    * @return String width in pixels.
    */
-  uint8_t mgos_ssd1306_draw_string (struct mgos_ssd1306 *oled, uint8_t x, uint8_t y, const char *str);
+  uint16_t mgos_ssd1306_draw_string (struct mgos_ssd1306 *oled, int16_t x, int16_t y, const char *str);
 
   /**
    * @brief Measure on-screen width of string if drawn using active font.
@@ -257,7 +603,55 @@ extern "C"
    *
    * @return String width in pixels.
    */
-  uint8_t mgos_ssd1306_measure_string (struct mgos_ssd1306 *oled, const char *str);
+  uint16_t mgos_ssd1306_measure_string (struct mgos_ssd1306 *oled, const char *str);
+
+  /**
+   * @brief Draw an integer in the active font without formatting it into a string first.
+   * Right aligned and centered output needs no measure pass.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Left edge, center or right edge (inclusive) of the text, depending on align.
+   * @param y Y coordinate.
+   * @param value Value to draw.
+   * @param align Alignment of the text relative to x.
+   * @param foreground Foreground color.
+   * @param background Background color.
+   *
+   * @return Text width in pixels.
+   */
+  uint16_t mgos_ssd1306_draw_int (struct mgos_ssd1306 *oled, int16_t x, int16_t y, int32_t value, mgos_ssd1306_align_t align,
+                                  mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background);
+
+  /**
+   * @brief Draw a fixed point number, value / 10^decimals, e.g. 215 with 1 decimal as "21.5".
+   * See mgos_ssd1306_draw_int().
+   *
+   * @param decimals Digits after the decimal point, at most 9.
+   *
+   * @return Text width in pixels.
+   */
+  uint16_t mgos_ssd1306_draw_fixed (struct mgos_ssd1306 *oled, int16_t x, int16_t y, int32_t value, uint8_t decimals,
+                                    mgos_ssd1306_align_t align, mgos_ssd1306_color_t foreground,
+                                    mgos_ssd1306_color_t background);
+
+  /**
+   * @brief Draw formatted text straight to glyphs, without a string buffer. Supports a
+   * subset of printf: %d %i %u %x %X %c %s %f %%, the '-' and '0' flags, field width,
+   * precision for %f (at most 9, default 6) and %s, and the 'l' length modifier.
+   * Right aligned and centered output is limited to 64 characters.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Left edge, center or right edge (inclusive) of the text, depending on align.
+   * @param y Y coordinate.
+   * @param align Alignment of the text relative to x.
+   * @param foreground Foreground color.
+   * @param background Background color.
+   * @param fmt Format string.
+   *
+   * @return Text width in pixels.
+   */
+  uint16_t mgos_ssd1306_draw_printf (struct mgos_ssd1306 *oled, int16_t x, int16_t y, mgos_ssd1306_align_t align,
+                                     mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background, const char *fmt, ...);
 
   /**
    * @brief Get the height of the active font.
@@ -305,7 +699,31 @@ extern "C"
   void mgos_ssd1306_rotate_display (struct mgos_ssd1306 *oled, bool alt);
 
   /**
-   * @brief Copy pre-rendered bytes directly into the bitmap.
+   * @brief Rotate drawing by 90 or 270 degrees in software (portrait mode), or back to
+   * 0. The canvas becomes panel height wide and panel width tall, and is cleared.
+   * Refresh transposes the dirty window into panel pages 8x8 pixels at a time. Needs a
+   * frame buffer the size of the panel, no layers or gray canvas, and no offscreen
+   * canvas selected.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param rotation 0, 90 (clockwise) or 270 degrees.
+   *
+   * @return true if the rotation was set.
+   */
+  bool mgos_ssd1306_set_rotation (struct mgos_ssd1306 *oled, uint16_t rotation);
+
+  /**
+   * @brief Get the software rotation.
+   *
+   * @param oled SSD1306 driver handle.
+   *
+   * @return 0, 90 or 270 degrees.
+   */
+  uint16_t mgos_ssd1306_get_rotation (struct mgos_ssd1306 *oled);
+
+  /**
+   * @brief Copy pre-rendered bytes directly into the bitmap. Not available without
+   * a frame buffer.
    *
    * @param oled SSD1306 driver handle.
    * @param data Array containing bytes to copy into buffer.
@@ -313,6 +731,717 @@ extern "C"
    */
   void mgos_ssd1306_update_buffer (struct mgos_ssd1306 *oled, uint8_t * data, uint16_t length);
 
+  /**
+   * @brief Allocate an empty display list.
+   *
+   * @return Display list handle, or NULL when out of memory.
+   */
+  struct mgos_ssd1306_dlist *mgos_ssd1306_dlist_create (void);
+
+  /**
+   * @brief Free a display list.
+   *
+   * @param dl Display list handle.
+   */
+  void mgos_ssd1306_dlist_free (struct mgos_ssd1306_dlist *dl);
+
+  /**
+   * @brief Start recording a frame into a display list. Until mgos_ssd1306_dlist_end()
+   * drawing calls on this driver are recorded instead of drawn, and
+   * mgos_ssd1306_clear() does nothing: the list describes the whole canvas over a
+   * black background. Recording starts with the clip rectangle reset to the canvas.
+   * Not available in paged mode, which already records every drawing call; drawing
+   * then goes on as usual.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param dl Display list handle.
+   */
+  void mgos_ssd1306_dlist_begin (struct mgos_ssd1306 *oled, struct mgos_ssd1306_dlist *dl);
+
+  /**
+   * @brief Stop recording and bring the canvas up to date with the recorded frame.
+   * Commands are compared with the previous frame of the same list in recording
+   * order; only the areas of commands that were added, removed or changed are
+   * redrawn and marked dirty for the next refresh. Record the same layout in the
+   * same order every frame to keep the damaged areas small.
+   *
+   * @param oled SSD1306 driver handle.
+   */
+  void mgos_ssd1306_dlist_end (struct mgos_ssd1306 *oled);
+
+  /**
+   * @brief Forget the previous frame of a display list, so the next one redraws the
+   * whole canvas. Call this after drawing on the canvas outside of the list.
+   *
+   * @param dl Display list handle.
+   */
+  void mgos_ssd1306_dlist_invalidate (struct mgos_ssd1306_dlist *dl);
+
+  /**
+   * @brief Create a text label widget. Widgets are drawn in creation order by
+   * mgos_ssd1306_widgets_update(), later ones on top; they start white on black with
+   * font 0. The text is copied.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param w Width.
+   * @param h Height.
+   * @param text Label text, may be NULL.
+   *
+   * @return Widget handle, or NULL when out of memory.
+   */
+  struct mgos_ssd1306_widget *mgos_ssd1306_label_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                                         const char *text);
+
+  /**
+   * @brief Create a numeric value widget, right aligned. See mgos_ssd1306_widget_set_value()
+   * and mgos_ssd1306_widget_set_format().
+   *
+   * @return Widget handle, or NULL when out of memory.
+   */
+  struct mgos_ssd1306_widget *mgos_ssd1306_value_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h);
+
+  /**
+   * @brief Create a progress bar widget: an outline filled in proportion to the value
+   * within the range, 0 to 100 unless set with mgos_ssd1306_widget_set_range().
+   *
+   * @return Widget handle, or NULL when out of memory.
+   */
+  struct mgos_ssd1306_widget *mgos_ssd1306_progress_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w,
+                                                            uint16_t h);
+
+  /**
+   * @brief Create an icon widget showing a bitmap of the widget's size, in the format
+   * of mgos_ssd1306_draw_bitmap(). The bitmap is not copied.
+   *
+   * @return Widget handle, or NULL when out of memory.
+   */
+  struct mgos_ssd1306_widget *mgos_ssd1306_icon_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                                        const uint8_t *bitmap);
+
+  /**
+   * @brief Create a list widget showing one item per row with the selection inverted.
+   * See mgos_ssd1306_widget_set_items() and mgos_ssd1306_widget_select().
+   *
+   * @return Widget handle, or NULL when out of memory.
+   */
+  struct mgos_ssd1306_widget *mgos_ssd1306_list_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h);
+
+  /**
+   * @brief Remove a widget and free it. The area it covered is redrawn on the next update.
+   *
+   * @param w Widget handle.
+   */
+  void mgos_ssd1306_widget_free (struct mgos_ssd1306_widget *w);
+
+  /**
+   * @brief Create a strip chart widget showing the last w samples of up to
+   * SSD1306_CHART_MAX_SERIES series as lines, the newest on the right, scaled to a range
+   * of 0 to 100 unless set with mgos_ssd1306_widget_set_range(). See mgos_ssd1306_chart_push().
+   *
+   * @param series Number of values per sample.
+   * @return Widget handle, or NULL when out of memory or series is invalid.
+   */
+  struct mgos_ssd1306_widget *mgos_ssd1306_chart_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                                         uint8_t series);
+
+  /**
+   * @brief Add a sample to a strip chart. With a frame buffer, and unless another widget
+   * overlaps the chart, the chart is scrolled left by a column and only the new column is
+   * drawn right away, so the next refresh sends just the chart; otherwise the chart is
+   * redrawn on the next update.
+   *
+   * @param w Chart widget handle.
+   * @param values One value per series.
+   */
+  void mgos_ssd1306_chart_push (struct mgos_ssd1306_widget *w, const int32_t *values);
+
+  /**
+   * @brief Create a bar graph widget of count bars side by side, growing up from the
+   * bottom in proportion to their values within a range of 0 to 100, unless set with
+   * mgos_ssd1306_widget_set_range(). Bars wider than a column are one column apart.
+   *
+   * @param count Number of bars, at most w.
+   * @return Widget handle, or NULL when out of memory or the bars do not fit.
+   */
+  struct mgos_ssd1306_widget *mgos_ssd1306_bars_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                                        uint16_t count);
+
+  /**
+   * @brief Set the value of a bar. With a frame buffer, and unless another widget
+   * overlaps the graph, only the rows between the old and the new top of the bar are
+   * filled or cleared right away, and only they are sent by the next refresh.
+   *
+   * @param w Bar graph widget handle.
+   * @param index Bar, from 0 on the left.
+   * @param value New value.
+   */
+  void mgos_ssd1306_bars_set_value (struct mgos_ssd1306_widget *w, uint16_t index, int32_t value);
+
+  /**
+   * @brief Move or resize a widget.
+   */
+  void mgos_ssd1306_widget_set_bounds (struct mgos_ssd1306_widget *w, int16_t x, int16_t y, uint16_t width, uint16_t height);
+
+  /**
+   * @brief Show or hide a widget.
+   */
+  void mgos_ssd1306_widget_set_visible (struct mgos_ssd1306_widget *w, bool visible);
+
+  /**
+   * @brief Set widget colors. A background other than SSD1306_COLOR_TRANSPARENT fills
+   * the whole widget before its content is drawn.
+   */
+  void mgos_ssd1306_widget_set_colors (struct mgos_ssd1306_widget *w, mgos_ssd1306_color_t foreground,
+                                       mgos_ssd1306_color_t background);
+
+  /**
+   * @brief Set the font of a text widget, see mgos_ssd1306_select_font().
+   */
+  void mgos_ssd1306_widget_set_font (struct mgos_ssd1306_widget *w, uint8_t font);
+
+  /**
+   * @brief Set horizontal text alignment of a label or value widget.
+   */
+  void mgos_ssd1306_widget_set_align (struct mgos_ssd1306_widget *w, mgos_ssd1306_align_t align);
+
+  /**
+   * @brief Set label text. The text is copied.
+   */
+  void mgos_ssd1306_widget_set_text (struct mgos_ssd1306_widget *w, const char *text);
+
+  /**
+   * @brief Set the value of a value or progress bar widget.
+   */
+  void mgos_ssd1306_widget_set_value (struct mgos_ssd1306_widget *w, int32_t value);
+
+  /**
+   * @brief Set the range of a progress bar, chart or bar graph widget.
+   */
+  void mgos_ssd1306_widget_set_range (struct mgos_ssd1306_widget *w, int32_t min, int32_t max);
+
+  /**
+   * @brief Set how a value widget shows its value: with decimals digits after the
+   * decimal point (the value is in units of 10^-decimals) and an optional unit suffix.
+   */
+  void mgos_ssd1306_widget_set_format (struct mgos_ssd1306_widget *w, uint8_t decimals, const char *unit);
+
+  /**
+   * @brief Set the bitmap of an icon widget. The bitmap is not copied.
+   */
+  void mgos_ssd1306_widget_set_bitmap (struct mgos_ssd1306_widget *w, const uint8_t *bitmap);
+
+  /**
+   * @brief Set the items of a list widget and select the first one. The array and
+   * strings are not copied and must stay valid while the widget shows them.
+   */
+  void mgos_ssd1306_widget_set_items (struct mgos_ssd1306_widget *w, const char *const *items, uint16_t count);
+
+  /**
+   * @brief Select a list item, scrolling the list to keep it visible.
+   */
+  void mgos_ssd1306_widget_select (struct mgos_ssd1306_widget *w, uint16_t index);
+
+  /**
+   * @brief Get the selected list item.
+   */
+  uint16_t mgos_ssd1306_widget_get_selected (struct mgos_ssd1306_widget *w);
+
+  /**
+   * @brief Mark a widget for redrawing, e.g. after changing the bitmap or list items it shows.
+   */
+  void mgos_ssd1306_widget_invalidate (struct mgos_ssd1306_widget *w);
+
+  /**
+   * @brief Redraw the widgets whose properties changed, together with whatever
+   * overlaps them, and refresh the display. Setters that do not change anything
+   * cause no redraw.
+   *
+   * @param oled SSD1306 driver handle.
+   */
+  void mgos_ssd1306_widgets_update (struct mgos_ssd1306 *oled);
+
+  /**
+   * @brief Create a text field for readouts such as clocks and counters. Setting its
+   * text redraws only the glyphs that changed or moved. The field is one line of the
+   * font high, starts white on black and draws nothing until its text is set.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param w Width; text is aligned within and clipped to it.
+   * @param font Font index, see mgos_ssd1306_select_font().
+   * @param align Horizontal alignment.
+   *
+   * @return Text field handle, or NULL when out of memory.
+   */
+  struct mgos_ssd1306_textfield *mgos_ssd1306_textfield_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w,
+                                                                uint8_t font, mgos_ssd1306_align_t align);
+
+  /**
+   * @brief Free a text field. Its pixels stay on the canvas.
+   *
+   * @param tf Text field handle.
+   */
+  void mgos_ssd1306_textfield_free (struct mgos_ssd1306_textfield *tf);
+
+  /**
+   * @brief Set text field colors; the whole field is redrawn with the next text.
+   *
+   * @param tf Text field handle.
+   * @param foreground Text color.
+   * @param background SSD1306_COLOR_BLACK or SSD1306_COLOR_WHITE, anything else is black.
+   */
+  void mgos_ssd1306_textfield_set_colors (struct mgos_ssd1306_textfield *tf, mgos_ssd1306_color_t foreground,
+                                          mgos_ssd1306_color_t background);
+
+  /**
+   * @brief Draw new text into a text field, touching only the glyph cells that differ
+   * from the text shown. Call mgos_ssd1306_refresh() afterwards as usual.
+   *
+   * @param tf Text field handle.
+   * @param text Text to show.
+   */
+  void mgos_ssd1306_textfield_set_text (struct mgos_ssd1306_textfield *tf, const char *text);
+
+  /**
+   * @brief Make the next mgos_ssd1306_textfield_set_text() draw the whole field, e.g.
+   * after the canvas was cleared or drawn over.
+   *
+   * @param tf Text field handle.
+   */
+  void mgos_ssd1306_textfield_invalidate (struct mgos_ssd1306_textfield *tf);
+
+  /**
+   * @brief Create a ticker: text scrolling left through a one line box, one font
+   * high, and coming in again from the right once it has left. It starts white on
+   * black and draws nothing until mgos_ssd1306_ticker_step() is called.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param w Width.
+   * @param font Font index, see mgos_ssd1306_select_font().
+   *
+   * @return Ticker handle, or NULL when out of memory.
+   */
+  struct mgos_ssd1306_ticker *mgos_ssd1306_ticker_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w,
+                                                          uint8_t font);
+
+  /**
+   * @brief Free a ticker, stopping hardware scrolling. What it drew stays on the canvas.
+   *
+   * @param t Ticker handle.
+   */
+  void mgos_ssd1306_ticker_free (struct mgos_ssd1306_ticker *t);
+
+  /**
+   * @brief Set ticker colors. The background is black unless SSD1306_COLOR_WHITE.
+   * The text starts over on the next step.
+   */
+  void mgos_ssd1306_ticker_set_colors (struct mgos_ssd1306_ticker *t, mgos_ssd1306_color_t foreground,
+                                       mgos_ssd1306_color_t background);
+
+  /**
+   * @brief Set the text of a ticker, which is copied. The box is cleared on the next
+   * step and the text comes in from the right.
+   *
+   * @param t Ticker handle.
+   * @param text Text to show.
+   */
+  void mgos_ssd1306_ticker_set_text (struct mgos_ssd1306_ticker *t, const char *text);
+
+  /**
+   * @brief Scroll a ticker left by n pixels. The box is moved in the frame buffer and
+   * only the n columns coming in are drawn; the box is marked for refresh. This cannot
+   * be recorded in a display list.
+   *
+   * @param t Ticker handle.
+   * @param n Pixels to scroll.
+   */
+  void mgos_ssd1306_ticker_step (struct mgos_ssd1306_ticker *t, uint16_t n);
+
+  /**
+   * @brief Let the controller scroll a ticker whose text is no wider than the panel,
+   * so it takes no CPU time or transfers. The text is drawn at the left of the box and
+   * sent, then rotates around the panel by a pixel every given number of frames,
+   * rounded to one of 2, 3, 4, 5, 25, 64, 128 or 256. The box must span a 128 pixel
+   * wide panel and start on a page boundary; the other rows of its pages scroll with
+   * it, so nothing else should be drawn there until the scrolling stops.
+   *
+   * @param t Ticker handle.
+   * @param frames Frames per pixel.
+   *
+   * @return true if scrolling started.
+   */
+  bool mgos_ssd1306_ticker_start_hardware (struct mgos_ssd1306_ticker *t, uint16_t frames);
+
+  /**
+   * @brief Stop hardware scrolling; the pages it moved are sent again on the next refresh,
+   * and the next step starts the text over.
+   *
+   * @param t Ticker handle.
+   */
+  void mgos_ssd1306_ticker_stop_hardware (struct mgos_ssd1306_ticker *t);
+
+  /**
+   * @brief Create a layer on top of the canvas and the existing layers, e.g. for a
+   * cursor, a toast or an overlay that changes without redrawing what is below it.
+   * The canvas and visible layers are composited over the dirty region on refresh.
+   * An unmasked layer adds its white pixels; a masked layer shows its own pixels
+   * wherever its mask is white. Layers start empty and visible. Not available in
+   * paged mode.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param masked Give the layer a mask.
+   *
+   * @return Layer handle, or NULL on error.
+   */
+  struct mgos_ssd1306_layer *mgos_ssd1306_layer_create (struct mgos_ssd1306 *oled, bool masked);
+
+  /**
+   * @brief Remove a layer and free it. The canvas is selected for drawing if the layer was.
+   *
+   * @param layer Layer handle.
+   */
+  void mgos_ssd1306_layer_free (struct mgos_ssd1306_layer *layer);
+
+  /**
+   * @brief Select where drawing calls, mgos_ssd1306_clear() and
+   * mgos_ssd1306_update_buffer() go: the canvas, a layer's pixels or a layer's mask.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param layer Layer handle, NULL for the canvas.
+   * @param mask Draw into the layer's mask instead of its pixels.
+   */
+  void mgos_ssd1306_select_layer (struct mgos_ssd1306 *oled, struct mgos_ssd1306_layer *layer, bool mask);
+
+  /**
+   * @brief Show or hide a layer; the area it covers is sent on the next refresh.
+   *
+   * @param layer Layer handle.
+   * @param visible Show the layer.
+   */
+  void mgos_ssd1306_layer_set_visible (struct mgos_ssd1306_layer *layer, bool visible);
+
+  /**
+   * @brief Create a 2-bit gray canvas shown by temporal dithering: the panel
+   * alternates between the two bit planes fast enough to blend them into 4 levels.
+   * While it exists it replaces the canvas on the panel, and mgos_ssd1306_refresh()
+   * does nothing; frames are sent by mgos_ssd1306_gray_start() or
+   * mgos_ssd1306_gray_frame(). Needs a frame buffer the size of the panel and no layers.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param weighted Show the low plane at half contrast, which needs 2 frames per
+   * cycle instead of 3 and flickers less, at the cost of maximum brightness.
+   *
+   * @return Gray canvas handle, or NULL on error.
+   */
+  struct mgos_ssd1306_gray *mgos_ssd1306_gray_create (struct mgos_ssd1306 *oled, bool weighted);
+
+  /**
+   * @brief Stop and free a gray canvas; the next refresh shows the canvas again. A
+   * weighted canvas puts back the contrast that was set when it was created.
+   *
+   * @param gray Gray canvas handle.
+   */
+  void mgos_ssd1306_gray_free (struct mgos_ssd1306_gray *gray);
+
+  /**
+   * @brief Set a pixel of the gray canvas.
+   *
+   * @param gray Gray canvas handle.
+   * @param x X coordinate.
+   * @param y Y coordinate.
+   * @param level Gray level, 0 (black) to 3 (white).
+   */
+  void mgos_ssd1306_gray_pixel (struct mgos_ssd1306_gray *gray, int16_t x, int16_t y, uint8_t level);
+
+  /**
+   * @brief Fill a rectangle of the gray canvas.
+   *
+   * @param gray Gray canvas handle.
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param w Width.
+   * @param h Height.
+   * @param level Gray level, 0 (black) to 3 (white).
+   */
+  void mgos_ssd1306_gray_fill_rectangle (struct mgos_ssd1306_gray *gray, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                         uint8_t level);
+
+  /**
+   * @brief Draw into one bit plane of the gray canvas with the regular drawing calls.
+   * mgos_ssd1306_select_layer (oled, NULL, false) selects the canvas again.
+   *
+   * @param gray Gray canvas handle.
+   * @param plane 0 for the low bit, 1 for the high bit.
+   */
+  void mgos_ssd1306_gray_select_plane (struct mgos_ssd1306_gray *gray, uint8_t plane);
+
+  /**
+   * @brief Send the next frame of the cycle: the columns where the planes differ when
+   * the plane changes, plus whatever was drawn since the plane was last sent.
+   *
+   * @param gray Gray canvas handle.
+   */
+  void mgos_ssd1306_gray_frame (struct mgos_ssd1306_gray *gray);
+
+  /**
+   * @brief Send frames from a timer at a fixed rate. The rate the panel can sustain
+   * depends on the I2C clock and the gray area; see mgos_ssd1306_gray_get_stats().
+   *
+   * @param gray Gray canvas handle.
+   * @param rate Frames per second.
+   *
+   * @return true if the timer was started.
+   */
+  bool mgos_ssd1306_gray_start (struct mgos_ssd1306_gray *gray, uint16_t rate);
+
+  /**
+   * @brief Stop sending frames; the panel keeps the last one.
+   *
+   * @param gray Gray canvas handle.
+   */
+  void mgos_ssd1306_gray_stop (struct mgos_ssd1306_gray *gray);
+
+  /**
+   * @brief Get frame statistics since the gray canvas was created, any pointer may be NULL.
+   *
+   * @param gray Gray canvas handle.
+   * @param frames Frames sent.
+   * @param bytes Data bytes sent.
+   * @param busy_us Time spent sending frames, in microseconds.
+   */
+  void mgos_ssd1306_gray_get_stats (struct mgos_ssd1306_gray *gray, uint32_t *frames, uint32_t *bytes, uint32_t *busy_us);
+
+  /**
+   * @brief Create an offscreen canvas in the frame buffer layout, cleared to black, to
+   * draw sprites, icons, cached text or popups once and blit them where needed.
+   *
+   * @param width Width in pixels.
+   * @param height Height in pixels, rounded up to a multiple of 8.
+   *
+   * @return Canvas handle, or NULL on error.
+   */
+  struct mgos_ssd1306_canvas *mgos_ssd1306_canvas_create (uint16_t width, uint16_t height);
+
+  /**
+   * @brief Free an offscreen canvas; if it is selected, the driver canvas is selected again.
+   *
+   * @param canvas Canvas handle.
+   */
+  void mgos_ssd1306_canvas_free (struct mgos_ssd1306_canvas *canvas);
+
+  /**
+   * @brief Make the drawing calls go to an offscreen canvas, with its own clip rectangle,
+   * or back to the driver when canvas is NULL. Drawing into a canvas bypasses display
+   * lists, so it also works in paged mode. Select the driver again before refreshing.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param canvas Canvas handle, or NULL.
+   */
+  void mgos_ssd1306_select_canvas (struct mgos_ssd1306 *oled, struct mgos_ssd1306_canvas *canvas);
+
+  /**
+   * @brief Combine a rectangle of a canvas into the drawing buffer (the driver canvas, a
+   * layer or an offscreen canvas) with a raster operation, clipped. Any bit offset
+   * works; the rows are shifted and merged a byte per column. Source and destination
+   * may overlap. Not available while a display list is recorded or in paged mode.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param dx Destination left edge.
+   * @param dy Destination top edge.
+   * @param src Source canvas, or NULL for the driver canvas.
+   * @param sx Source left edge.
+   * @param sy Source top edge.
+   * @param w Width.
+   * @param h Height.
+   * @param rop Raster operation.
+   */
+  void mgos_ssd1306_blit (struct mgos_ssd1306 *oled, int16_t dx, int16_t dy, const struct mgos_ssd1306_canvas *src,
+                          int16_t sx, int16_t sy, uint16_t w, uint16_t h, mgos_ssd1306_rop_t rop);
+
+  /**
+   * @brief Shift the contents of a rectangle of the drawing buffer by any number of
+   * pixels, clipped. Pixels moved out of the rectangle are dropped, and the area
+   * uncovered is filled. Only the rectangle is marked dirty. Not available while a
+   * display list is recorded or in paged mode.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param w Width.
+   * @param h Height.
+   * @param dx Horizontal offset, positive to the right.
+   * @param dy Vertical offset, positive down.
+   * @param fill Color of the uncovered area, SSD1306_COLOR_TRANSPARENT leaves it alone.
+   */
+  void mgos_ssd1306_scroll_region (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h, int16_t dx,
+                                   int16_t dy, mgos_ssd1306_color_t fill);
+
+  /**
+   * @brief Size of the buffer mgos_ssd1306_save_region() needs for a rectangle: its
+   * width times the number of pages it touches.
+   *
+   * @return Size in bytes.
+   */
+  uint32_t mgos_ssd1306_region_size (int16_t y, uint16_t w, uint16_t h);
+
+  /**
+   * @brief Copy the page bytes under a rectangle of the drawing buffer into buffer,
+   * e.g. before drawing a popup over it. Not available while a display list is
+   * recorded or in paged mode.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param w Width.
+   * @param h Height.
+   * @param buffer mgos_ssd1306_region_size() bytes.
+   */
+  void mgos_ssd1306_save_region (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h, uint8_t *buffer);
+
+  /**
+   * @brief Put back a rectangle saved with mgos_ssd1306_save_region(), with the same
+   * coordinates. Only the rectangle is changed and marked dirty.
+   */
+  void mgos_ssd1306_restore_region (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                    const uint8_t *buffer);
+
+  /**
+   * @brief Save a rectangle of the drawing buffer on the driver's stack of saved
+   * regions, whose memory is kept and reused. Popups opened over each other push
+   * their regions in turn and pop them in reverse order.
+   *
+   * @return true if saved, false when out of memory.
+   */
+  bool mgos_ssd1306_push_region (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h);
+
+  /**
+   * @brief Restore the region saved last by mgos_ssd1306_push_region() and drop it.
+   * Only that rectangle is marked dirty.
+   *
+   * @return false if no region is saved, or while a display list is recorded or in
+   * paged mode; the region stays saved then.
+   */
+  bool mgos_ssd1306_pop_region (struct mgos_ssd1306 *oled);
+
+  /**
+   * @brief Keep a copy of the canvas as a named screen, e.g. once the static parts of
+   * a screen are drawn. Storing a name again replaces its image. Not available while a
+   * display list is recorded, in paged mode, or with the gray canvas or an offscreen
+   * canvas selected.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param name Screen name, copied.
+   * @param path File to keep the image in, or NULL to keep it in memory.
+   *
+   * @return true if stored.
+   */
+  bool mgos_ssd1306_screen_store (struct mgos_ssd1306 *oled, const char *name, const char *path);
+
+  /**
+   * @brief Switch to a stored screen: copy its image into the canvas, call cb to draw
+   * the fields that change, and send the bytes that differ from what the panel shows,
+   * along with the dirty window. Screens that share most of their layout send little.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param name Screen name.
+   * @param cb Called after the image is copied, or NULL.
+   * @param arg Passed to cb.
+   *
+   * @return false if the screen is not stored or cannot be read; the canvas is unchanged then.
+   */
+  bool mgos_ssd1306_screen_show (struct mgos_ssd1306 *oled, const char *name, mgos_ssd1306_screen_cb_t cb, void *arg);
+
+  /**
+   * @brief Forget a stored screen. A file it was kept in is left alone.
+   */
+  void mgos_ssd1306_screen_drop (struct mgos_ssd1306 *oled, const char *name);
+
+  /**
+   * @brief Create a player for a delta-compressed animation held in memory, usually a
+   * const array in flash. The format is described in ssd1306_anim.c. The data is read
+   * in place and must stay valid until the player is freed. Needs a frame buffer.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Left edge of the animation on the canvas.
+   * @param y Top edge of the animation on the canvas; on a multiple of 8 the changes are
+   * sent straight to the panel.
+   * @param data Animation data.
+   * @param size Size of the data in bytes.
+   *
+   * @return Animation handle, or NULL on error.
+   */
+  struct mgos_ssd1306_anim *mgos_ssd1306_anim_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y,
+                                                      const uint8_t *data, uint32_t size);
+
+  /**
+   * @brief Like mgos_ssd1306_anim_create(), with the animation streamed from a file,
+   * which stays open until the player is freed.
+   *
+   * @param oled SSD1306 driver handle.
+   * @param x Left edge of the animation on the canvas.
+   * @param y Top edge of the animation on the canvas.
+   * @param path File name.
+   *
+   * @return Animation handle, or NULL on error.
+   */
+  struct mgos_ssd1306_anim *mgos_ssd1306_anim_open (struct mgos_ssd1306 *oled, int16_t x, int16_t y, const char *path);
+
+  /**
+   * @brief Stop and free an animation player; free it before closing the driver.
+   *
+   * @param anim Animation handle.
+   */
+  void mgos_ssd1306_anim_free (struct mgos_ssd1306_anim *anim);
+
+  /**
+   * @brief Copy the next frame into the frame buffer, clipped, and send the bytes that
+   * changed. With layers, the gray canvas, or a top edge that is not on a panel page,
+   * the changes are marked dirty and sent by mgos_ssd1306_refresh() instead.
+   *
+   * @param anim Animation handle.
+   *
+   * @return false after the last frame or on invalid data.
+   */
+  bool mgos_ssd1306_anim_step (struct mgos_ssd1306_anim *anim);
+
+  /**
+   * @brief Go back to the keyframe; the next step shows the first frame again.
+   *
+   * @param anim Animation handle.
+   */
+  void mgos_ssd1306_anim_rewind (struct mgos_ssd1306_anim *anim);
+
+  /**
+   * @brief Step through the frames from a timer at the animation's frame period.
+   *
+   * @param anim Animation handle.
+   * @param loop Start over after the last frame instead of stopping.
+   *
+   * @return true if the timer was started.
+   */
+  bool mgos_ssd1306_anim_start (struct mgos_ssd1306_anim *anim, bool loop);
+
+  /**
+   * @brief Stop playing; the panel keeps the current frame.
+   *
+   * @param anim Animation handle.
+   */
+  void mgos_ssd1306_anim_stop (struct mgos_ssd1306_anim *anim);
+
+  /**
+   * @brief Get the number of the next frame to be shown, 0 before the keyframe.
+   *
+   * @param anim Animation handle.
+   *
+   * @return Frame number.
+   */
+  uint16_t mgos_ssd1306_anim_get_frame (struct mgos_ssd1306_anim *anim);
+
   /**
    * @brief Sends a command without parameters to the display
    *
@@ -37,15 +37,86 @@ let SSD1306 = {
   _getGlobal: ffi('void *mgos_ssd1306_get_global(void)'),
   _getWidth: ffi('int mgos_ssd1306_get_width(void *)'),
   _getHeight: ffi('int mgos_ssd1306_get_height (void *)'),
+  _getCanvasWidth: ffi('int mgos_ssd1306_get_canvas_width(void *)'),
+  _getCanvasHeight: ffi('int mgos_ssd1306_get_canvas_height(void *)'),
+  _setViewport: ffi('void mgos_ssd1306_set_viewport(void *, int, int)'),
+  _getViewportX: ffi('int mgos_ssd1306_get_viewport_x(void *)'),
+  _getViewportY: ffi('int mgos_ssd1306_get_viewport_y(void *)'),
+  _setClip: ffi('void mgos_ssd1306_set_clip(void *, int, int, int, int)'),
+  _resetClip: ffi('void mgos_ssd1306_reset_clip(void *)'),
+  _dlistCreate: ffi('void *mgos_ssd1306_dlist_create(void)'),
+  _dlistFree: ffi('void mgos_ssd1306_dlist_free(void *)'),
+  _dlistBegin: ffi('void mgos_ssd1306_dlist_begin(void *, void *)'),
+  _dlistEnd: ffi('void mgos_ssd1306_dlist_end(void *)'),
+  _dlistInvalidate: ffi('void mgos_ssd1306_dlist_invalidate(void *)'),
+  _labelCreate: ffi('void *mgos_ssd1306_label_create(void *, int, int, int, int, char *)'),
+  _valueCreate: ffi('void *mgos_ssd1306_value_create(void *, int, int, int, int)'),
+  _progressCreate: ffi('void *mgos_ssd1306_progress_create(void *, int, int, int, int)'),
+  _widgetFree: ffi('void mgos_ssd1306_widget_free(void *)'),
+  _widgetSetBounds: ffi('void mgos_ssd1306_widget_set_bounds(void *, int, int, int, int)'),
+  _widgetSetVisible: ffi('void mgos_ssd1306_widget_set_visible(void *, bool)'),
+  _widgetSetColors: ffi('void mgos_ssd1306_widget_set_colors(void *, int, int)'),
+  _widgetSetFont: ffi('void mgos_ssd1306_widget_set_font(void *, int)'),
+  _widgetSetAlign: ffi('void mgos_ssd1306_widget_set_align(void *, int)'),
+  _widgetSetText: ffi('void mgos_ssd1306_widget_set_text(void *, char *)'),
+  _widgetSetValue: ffi('void mgos_ssd1306_widget_set_value(void *, int)'),
+  _widgetSetRange: ffi('void mgos_ssd1306_widget_set_range(void *, int, int)'),
+  _widgetSetFormat: ffi('void mgos_ssd1306_widget_set_format(void *, int, char *)'),
+  _widgetsUpdate: ffi('void mgos_ssd1306_widgets_update(void *)'),
+  _chartCreate: ffi('void *mgos_ssd1306_chart_create(void *, int, int, int, int, int)'),
+  _chartPush: ffi('void mgos_ssd1306_chart_push(void *, char *)'),
+  _barsCreate: ffi('void *mgos_ssd1306_bars_create(void *, int, int, int, int, int)'),
+  _barsSetValue: ffi('void mgos_ssd1306_bars_set_value(void *, int, int)'),
+  _textfieldCreate: ffi('void *mgos_ssd1306_textfield_create(void *, int, int, int, int, int)'),
+  _textfieldFree: ffi('void mgos_ssd1306_textfield_free(void *)'),
+  _textfieldSetColors: ffi('void mgos_ssd1306_textfield_set_colors(void *, int, int)'),
+  _textfieldSetText: ffi('void mgos_ssd1306_textfield_set_text(void *, char *)'),
+  _textfieldInvalidate: ffi('void mgos_ssd1306_textfield_invalidate(void *)'),
+  _tickerCreate: ffi('void *mgos_ssd1306_ticker_create(void *, int, int, int, int)'),
+  _tickerFree: ffi('void mgos_ssd1306_ticker_free(void *)'),
+  _tickerSetColors: ffi('void mgos_ssd1306_ticker_set_colors(void *, int, int)'),
+  _tickerSetText: ffi('void mgos_ssd1306_ticker_set_text(void *, char *)'),
+  _tickerStep: ffi('void mgos_ssd1306_ticker_step(void *, int)'),
+  _tickerStartHardware: ffi('bool mgos_ssd1306_ticker_start_hardware(void *, int)'),
+  _tickerStopHardware: ffi('void mgos_ssd1306_ticker_stop_hardware(void *)'),
+  _layerCreate: ffi('void *mgos_ssd1306_layer_create(void *, bool)'),
+  _layerFree: ffi('void mgos_ssd1306_layer_free(void *)'),
+  _selectLayer: ffi('void mgos_ssd1306_select_layer(void *, void *, bool)'),
+  _layerSetVisible: ffi('void mgos_ssd1306_layer_set_visible(void *, bool)'),
+  _grayCreate: ffi('void *mgos_ssd1306_gray_create(void *, bool)'),
+  _grayFree: ffi('void mgos_ssd1306_gray_free(void *)'),
+  _grayPixel: ffi('void mgos_ssd1306_gray_pixel(void *, int, int, int)'),
+  _grayFillRectangle: ffi('void mgos_ssd1306_gray_fill_rectangle(void *, int, int, int, int, int)'),
+  _grayStart: ffi('bool mgos_ssd1306_gray_start(void *, int)'),
+  _grayStop: ffi('void mgos_ssd1306_gray_stop(void *)'),
+  _animOpen: ffi('void *mgos_ssd1306_anim_open(void *, int, int, char *)'),
+  _animFree: ffi('void mgos_ssd1306_anim_free(void *)'),
+  _animStep: ffi('bool mgos_ssd1306_anim_step(void *)'),
+  _animRewind: ffi('void mgos_ssd1306_anim_rewind(void *)'),
+  _animStart: ffi('bool mgos_ssd1306_anim_start(void *, bool)'),
+  _animStop: ffi('void mgos_ssd1306_anim_stop(void *)'),
   _clear: ffi('void mgos_ssd1306_clear (void *)'),
   _refresh: ffi('void mgos_ssd1306_refresh (void *, bool)'),
   _drawPixel: ffi('void mgos_ssd1306_draw_pixel (void *, int, int, int)'),
+  _drawPixels: ffi('void mgos_ssd1306_draw_pixels (void *, char *, int, int)'),
   _drawHLine: ffi('void mgos_ssd1306_draw_hline (void *, int, int, int, int)'),
   _drawVLine: ffi('void mgos_ssd1306_draw_vline (void *, int, int, int, int)'),
+  _drawLine: ffi('void mgos_ssd1306_draw_line (void *, int, int, int, int, int)'),
   _drawRectangle: ffi('void mgos_ssd1306_draw_rectangle (void *, int, int, int, int, int)'),
   _fillRectangle: ffi('void mgos_ssd1306_fill_rectangle (void *, int, int, int, int, int)'),
+  _fillPolygon: ffi('void mgos_ssd1306_fill_polygon (void *, char *, int, int)'),
   _drawCircle: ffi('void mgos_ssd1306_draw_circle (void *, int, int, int, int)'),
   _fillCircle: ffi('void mgos_ssd1306_fill_circle (void *, int, int, int, int)'),
+  _drawEllipse: ffi('void mgos_ssd1306_draw_ellipse (void *, int, int, int, int, int)'),
+  _fillEllipse: ffi('void mgos_ssd1306_fill_ellipse (void *, int, int, int, int, int)'),
+  _drawImageFile: ffi('bool mgos_ssd1306_draw_image_file (void *, int, int, char *, int, int)'),
+  _drawQR: ffi('int mgos_ssd1306_draw_qr(void *, int, int, char *, int, int)'),
+  _pushRegion: ffi('bool mgos_ssd1306_push_region(void *, int, int, int, int)'),
+  _popRegion: ffi('bool mgos_ssd1306_pop_region(void *)'),
+  _screenStore: ffi('bool mgos_ssd1306_screen_store(void *, char *, char *)'),
+  _screenShow: ffi('bool mgos_ssd1306_screen_show(void *, char *, void (*)(void *, userdata), userdata)'),
+  _screenShowPlain: ffi('bool mgos_ssd1306_screen_show(void *, char *, void *, void *)'),
+  _screenDrop: ffi('void mgos_ssd1306_screen_drop(void *, char *)'),
   _selectFont: ffi('void mgos_ssd1306_select_font (void *, int)'),
   _drawChar: ffi('int mgos_ssd1306_draw_char (void *, int, int, int, int, int)'),
   _drawString: ffi('int mgos_ssd1306_draw_string(void *, int, int, char *)'),
@@ -56,9 +127,20 @@ let SSD1306 = {
   _invertDisplay: ffi('void mgos_ssd1306_invert_display(void *, bool)'),
   _flipDisplay: ffi('void mgos_ssd1306_flip_display(void *, bool, bool)'),
   _rotateDisplay: ffi('void mgos_ssd1306_rotate_display(void *, int)'),
+  _setRotation: ffi('bool mgos_ssd1306_set_rotation(void *, int)'),
   _updateBuffer: ffi('void mgos_ssd1306_update_buffer(void *, void *, int)'),
   _command: ffi('void mgos_ssd1306_command(void *, int)'),
   _start: ffi('void mgos_ssd1306_start(void *)'),
+
+  // Pack a flat [x0, y0, x1, y1, ...] array into an array of mgos_ssd1306_point_t
+  // (pairs of little endian 16-bit integers), so a whole shape crosses the FFI at once.
+  _packPoints: function(coords) {
+    let s = '';
+    for (let i = 0; i < coords.length; i++) {
+      s = s + chr(coords[i] & 0xff) + chr((coords[i] >> 8) & 0xff);
+    }
+    return s;
+  },
   
   /**
    * @brief Init function, need to be called before using the api
@@ -96,6 +178,483 @@ let SSD1306 = {
     return this._getHeight(this._oled);
   },
 
+  /**
+   * @brief Get drawing canvas width.
+   *
+   * @return Canvas width, in pixels.
+   */
+  getCanvasWidth: function() {
+    return this._getCanvasWidth(this._oled);
+  },
+
+  /**
+   * @brief Get drawing canvas height.
+   *
+   * @return Canvas height, in pixels.
+   */
+  getCanvasHeight: function() {
+    return this._getCanvasHeight(this._oled);
+  },
+
+  /**
+   * @brief Move the screen viewport over the canvas.
+   *
+   * @param x Canvas X coordinate shown at the left edge of the screen.
+   * @param y Canvas Y coordinate shown at the top edge of the screen.
+   */
+  setViewport: function(x, y) {
+    this._setViewport(this._oled, x, y);
+  },
+
+  /**
+   * @brief Get canvas X coordinate of the viewport.
+   *
+   * @return Viewport left edge, in canvas pixels.
+   */
+  getViewportX: function() {
+    return this._getViewportX(this._oled);
+  },
+
+  /**
+   * @brief Get canvas Y coordinate of the viewport.
+   *
+   * @return Viewport top edge, in canvas pixels.
+   */
+  getViewportY: function() {
+    return this._getViewportY(this._oled);
+  },
+
+  /**
+   * @brief Restrict drawing to a rectangle of the canvas.
+   *
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param w Width.
+   * @param h Height.
+   */
+  setClip: function(x, y, w, h) {
+    this._setClip(this._oled, x, y, w, h);
+  },
+
+  /**
+   * @brief Allow drawing on the whole canvas again.
+   */
+  resetClip: function() {
+    this._resetClip(this._oled);
+  },
+
+  /**
+   * @brief Allocate an empty display list.
+   *
+   * @return Display list handle.
+   */
+  createDisplayList: function() {
+    return this._dlistCreate();
+  },
+
+  /**
+   * @brief Free a display list.
+   *
+   * @param dl Display list handle.
+   */
+  freeDisplayList: function(dl) {
+    this._dlistFree(dl);
+  },
+
+  /**
+   * @brief Start recording drawing calls into a display list instead of drawing them.
+   * Not available in paged mode.
+   *
+   * @param dl Display list handle.
+   */
+  beginDisplayList: function(dl) {
+    this._dlistBegin(this._oled, dl);
+  },
+
+  /**
+   * @brief Stop recording and redraw only what changed since the list's previous frame.
+   */
+  endDisplayList: function() {
+    this._dlistEnd(this._oled);
+  },
+
+  /**
+   * @brief Make the next frame of a display list redraw the whole canvas.
+   *
+   * @param dl Display list handle.
+   */
+  invalidateDisplayList: function(dl) {
+    this._dlistInvalidate(dl);
+  },
+
+  /**
+   * @brief Create a text label widget, white on black. Widgets are redrawn by updateWidgets().
+   *
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param w Width.
+   * @param h Height.
+   * @param text Label text.
+   * @return Widget handle, null on error.
+   */
+  createLabel: function(x, y, w, h, text) {
+    return this._labelCreate(this._oled, x, y, w, h, text);
+  },
+
+  /**
+   * @brief Create a right aligned numeric value widget, see setWidgetValue() and setWidgetFormat().
+   *
+   * @return Widget handle, null on error.
+   */
+  createValue: function(x, y, w, h) {
+    return this._valueCreate(this._oled, x, y, w, h);
+  },
+
+  /**
+   * @brief Create a progress bar widget with a range of 0 to 100, see setWidgetRange().
+   *
+   * @return Widget handle, null on error.
+   */
+  createProgress: function(x, y, w, h) {
+    return this._progressCreate(this._oled, x, y, w, h);
+  },
+
+  /**
+   * @brief Create a strip chart widget with a range of 0 to 100, see setWidgetRange().
+   *
+   * @param series Number of values per sample, 1 to 4.
+   * @return Widget handle, null on error.
+   */
+  createChart: function(x, y, w, h, series) {
+    return this._chartCreate(this._oled, x, y, w, h, series);
+  },
+
+  /**
+   * @brief Add a sample to a strip chart: an array of one value per series.
+   */
+  chartPush: function(wd, values) {
+    let s = '';
+    for (let i = 0; i < values.length; i++) {
+      let v = values[i];
+      s = s + chr(v & 0xff) + chr((v >> 8) & 0xff) + chr((v >> 16) & 0xff) + chr((v >> 24) & 0xff);
+    }
+    this._chartPush(wd, s);
+  },
+
+  /**
+   * @brief Create a bar graph widget of count bars with a range of 0 to 100, see setWidgetRange().
+   *
+   * @return Widget handle, null on error.
+   */
+  createBars: function(x, y, w, h, count) {
+    return this._barsCreate(this._oled, x, y, w, h, count);
+  },
+
+  /**
+   * @brief Set the value of bar index of a bar graph, 0 being the leftmost.
+   */
+  setBarValue: function(wd, index, value) {
+    this._barsSetValue(wd, index, value);
+  },
+
+  /**
+   * @brief Remove a widget and free it.
+   *
+   * @param wd Widget handle.
+   */
+  freeWidget: function(wd) {
+    this._widgetFree(wd);
+  },
+
+  /**
+   * @brief Move or resize a widget.
+   */
+  setWidgetBounds: function(wd, x, y, w, h) {
+    this._widgetSetBounds(wd, x, y, w, h);
+  },
+
+  /**
+   * @brief Show or hide a widget.
+   */
+  setWidgetVisible: function(wd, visible) {
+    this._widgetSetVisible(wd, visible);
+  },
+
+  /**
+   * @brief Set widget colors; a background other than TRANSPARENT fills the widget.
+   */
+  setWidgetColors: function(wd, fg, bg) {
+    this._widgetSetColors(wd, fg, bg);
+  },
+
+  /**
+   * @brief Set the font of a text widget.
+   */
+  setWidgetFont: function(wd, font) {
+    this._widgetSetFont(wd, font);
+  },
+
+  /**
+   * @brief Set text alignment: 0 left, 1 center, 2 right.
+   */
+  setWidgetAlign: function(wd, align) {
+    this._widgetSetAlign(wd, align);
+  },
+
+  /**
+   * @brief Set the text of a label widget.
+   */
+  setWidgetText: function(wd, text) {
+    this._widgetSetText(wd, text);
+  },
+
+  /**
+   * @brief Set the value of a value or progress bar widget.
+   */
+  setWidgetValue: function(wd, value) {
+    this._widgetSetValue(wd, value);
+  },
+
+  /**
+   * @brief Set the range of a progress bar, chart or bar graph widget.
+   */
+  setWidgetRange: function(wd, min, max) {
+    this._widgetSetRange(wd, min, max);
+  },
+
+  /**
+   * @brief Show a value widget's value with decimals digits after the point and a unit.
+   */
+  setWidgetFormat: function(wd, decimals, unit) {
+    this._widgetSetFormat(wd, decimals, unit);
+  },
+
+  /**
+   * @brief Redraw the widgets that changed and refresh the display.
+   */
+  updateWidgets: function() {
+    this._widgetsUpdate(this._oled);
+  },
+
+  /**
+   * @brief Create a text field that redraws only the glyphs that change.
+   *
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param w Width.
+   * @param font Font index.
+   * @param align 0 left, 1 center, 2 right.
+   * @return Text field handle, null on error.
+   */
+  createTextField: function(x, y, w, font, align) {
+    return this._textfieldCreate(this._oled, x, y, w, font, align);
+  },
+
+  /**
+   * @brief Free a text field.
+   */
+  freeTextField: function(tf) {
+    this._textfieldFree(tf);
+  },
+
+  /**
+   * @brief Set text field colors.
+   */
+  setTextFieldColors: function(tf, fg, bg) {
+    this._textfieldSetColors(tf, fg, bg);
+  },
+
+  /**
+   * @brief Draw new text into a text field; call refresh() afterwards.
+   */
+  setTextFieldText: function(tf, text) {
+    this._textfieldSetText(tf, text);
+  },
+
+  /**
+   * @brief Redraw the whole text field on the next setTextFieldText().
+   */
+  invalidateTextField: function(tf) {
+    this._textfieldInvalidate(tf);
+  },
+
+  /**
+   * @brief Create a ticker scrolling text left through a one line box.
+   *
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param w Width.
+   * @param font Font index.
+   * @return Ticker handle, null on error.
+   */
+  createTicker: function(x, y, w, font) {
+    return this._tickerCreate(this._oled, x, y, w, font);
+  },
+
+  /**
+   * @brief Free a ticker.
+   */
+  freeTicker: function(t) {
+    this._tickerFree(t);
+  },
+
+  /**
+   * @brief Set ticker colors.
+   */
+  setTickerColors: function(t, fg, bg) {
+    this._tickerSetColors(t, fg, bg);
+  },
+
+  /**
+   * @brief Set the text of a ticker; it comes in from the right on the next steps.
+   */
+  setTickerText: function(t, text) {
+    this._tickerSetText(t, text);
+  },
+
+  /**
+   * @brief Scroll a ticker left by n pixels; call refresh() afterwards.
+   */
+  stepTicker: function(t, n) {
+    this._tickerStep(t, n);
+  },
+
+  /**
+   * @brief Let the display scroll a full width ticker by itself, a pixel every given number of frames.
+   *
+   * @return true if scrolling started.
+   */
+  startTickerHardware: function(t, frames) {
+    return this._tickerStartHardware(t, frames);
+  },
+
+  /**
+   * @brief Stop hardware scrolling of a ticker.
+   */
+  stopTickerHardware: function(t) {
+    this._tickerStopHardware(t);
+  },
+
+  /**
+   * @brief Create a layer on top of the canvas, composited on refresh.
+   *
+   * @param masked Give the layer a mask.
+   * @return Layer handle, null on error.
+   */
+  createLayer: function(masked) {
+    return this._layerCreate(this._oled, masked);
+  },
+
+  /**
+   * @brief Remove a layer and free it.
+   */
+  freeLayer: function(layer) {
+    this._layerFree(layer);
+  },
+
+  /**
+   * @brief Draw into a layer's pixels or mask, or into the canvas when layer is null.
+   */
+  selectLayer: function(layer, mask) {
+    this._selectLayer(this._oled, layer, mask);
+  },
+
+  /**
+   * @brief Show or hide a layer.
+   */
+  setLayerVisible: function(layer, visible) {
+    this._layerSetVisible(layer, visible);
+  },
+
+  /**
+   * @brief Create a 2-bit gray canvas shown by temporal dithering; see startGray().
+   *
+   * @param weighted Use contrast weighting, 2 frames per cycle instead of 3.
+   * @return Gray canvas handle, null on error.
+   */
+  createGray: function(weighted) {
+    return this._grayCreate(this._oled, weighted);
+  },
+
+  /**
+   * @brief Stop and free a gray canvas.
+   */
+  freeGray: function(gray) {
+    this._grayFree(gray);
+  },
+
+  /**
+   * @brief Set a gray pixel, level 0 (black) to 3 (white).
+   */
+  grayPixel: function(gray, x, y, level) {
+    this._grayPixel(gray, x, y, level);
+  },
+
+  /**
+   * @brief Fill a gray rectangle, level 0 (black) to 3 (white).
+   */
+  grayFillRectangle: function(gray, x, y, w, h, level) {
+    this._grayFillRectangle(gray, x, y, w, h, level);
+  },
+
+  /**
+   * @brief Send gray frames at a fixed rate in frames per second.
+   */
+  startGray: function(gray, rate) {
+    return this._grayStart(gray, rate);
+  },
+
+  /**
+   * @brief Stop sending gray frames.
+   */
+  stopGray: function(gray) {
+    this._grayStop(gray);
+  },
+
+  /**
+   * @brief Open a delta-compressed animation file to be played at x, y.
+   *
+   * @return Animation handle, null on error.
+   */
+  openAnimation: function(x, y, path) {
+    return this._animOpen(this._oled, x, y, path);
+  },
+
+  /**
+   * @brief Stop and free an animation.
+   */
+  freeAnimation: function(anim) {
+    this._animFree(anim);
+  },
+
+  /**
+   * @brief Show the next frame of an animation; false after the last one.
+   */
+  stepAnimation: function(anim) {
+    return this._animStep(anim);
+  },
+
+  /**
+   * @brief Go back to the first frame of an animation.
+   */
+  rewindAnimation: function(anim) {
+    this._animRewind(anim);
+  },
+
+  /**
+   * @brief Play an animation at its frame rate, once or in a loop.
+   */
+  startAnimation: function(anim, loop) {
+    return this._animStart(anim, loop);
+  },
+
+  /**
+   * @brief Stop playing an animation.
+   */
+  stopAnimation: function(anim) {
+    this._animStop(anim);
+  },
+
   /**
    * @brief Refresh the display, sending any dirty regions to the OLED controller for display.
    * Call this after you are finished calling any drawing primitives.
@@ -117,6 +676,16 @@ let SSD1306 = {
     this._drawPixel(this._oled, x, y, color);
   },
 
+  /**
+   * @brief Draw a batch of pixels with a single call.
+   *
+   * @param coords Flat array of pixel coordinates: [x0, y0, x1, y1, ...].
+   * @param color Pixel color.
+   */
+  drawPixels: function(coords, color) {
+    this._drawPixels(this._oled, this._packPoints(coords), coords.length / 2, color);
+  },
+
   /**
    * @brief Draw a horizontal line.
    *
@@ -141,6 +710,19 @@ let SSD1306 = {
     this._drawVLine(this._oled, x, y, h, color);
   },
 
+  /**
+   * @brief Draw a straight line between two points.
+   *
+   * @param x0 Start X coordinate.
+   * @param y0 Start Y coordinate.
+   * @param x1 End X coordinate.
+   * @param y1 End Y coordinate.
+   * @param color Line color.
+   */
+  drawLine: function(x0, y0, x1, y1, color) {
+    this._drawLine(this._oled, x0, y0, x1, y1, color);
+  },
+
   /**
    * @brief Draw an unfilled rectangle.
    *
@@ -167,6 +749,32 @@ let SSD1306 = {
     this._fillRectangle(this._oled, x, y, w, h, color);
   },
 
+  /**
+   * @brief Draw a filled polygon. Concave and self-intersecting polygons are filled
+   * with the even-odd rule.
+   *
+   * @param coords Flat array of vertex coordinates: [x0, y0, x1, y1, ...].
+   * @param color Fill color.
+   */
+  fillPolygon: function(coords, color) {
+    this._fillPolygon(this._oled, this._packPoints(coords), coords.length / 2, color);
+  },
+
+  /**
+   * @brief Draw a filled triangle.
+   *
+   * @param x0 First vertex X coordinate.
+   * @param y0 First vertex Y coordinate.
+   * @param x1 Second vertex X coordinate.
+   * @param y1 Second vertex Y coordinate.
+   * @param x2 Third vertex X coordinate.
+   * @param y2 Third vertex Y coordinate.
+   * @param color Fill color.
+   */
+  fillTriangle: function(x0, y0, x1, y1, x2, y2, color) {
+    this._fillPolygon(this._oled, this._packPoints([x0, y0, x1, y1, x2, y2]), 3, color);
+  },
+
   /**
    * @brief Draw an unfilled circle.
    *
@@ -191,6 +799,109 @@ let SSD1306 = {
     this._fillCircle(this._oled, x, y, r, color);
   },
 
+  /**
+   * @brief Draw an unfilled ellipse.
+   *
+   * @param x0 Center X coordinate.
+   * @param y0 Center Y coordinate.
+   * @param rx Horizontal radius.
+   * @param ry Vertical radius.
+   * @param color Line color.
+   */
+  drawEllipse: function(x, y, rx, ry, color) {
+    this._drawEllipse(this._oled, x, y, rx, ry, color);
+  },
+
+  /**
+   * @brief Draw a filled ellipse.
+   *
+   * @param x0 Center X coordinate.
+   * @param y0 Center Y coordinate.
+   * @param rx Horizontal radius.
+   * @param ry Vertical radius.
+   * @param color Line and fill color.
+   */
+  fillEllipse: function(x, y, rx, ry, color) {
+    this._fillEllipse(this._oled, x, y, rx, ry, color);
+  },
+
+  /**
+   * @brief Draw a monochrome PBM, XBM or 1bpp BMP image file, streamed from the filesystem.
+   *
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param path File name.
+   * @param fg Color of ink pixels.
+   * @param bg Color of the other pixels, TRANSPARENT leaves them alone.
+   * @return true if the whole image was drawn.
+   */
+  drawImageFile: function(x, y, path, fg, bg) {
+    return this._drawImageFile(this._oled, x, y, path, fg, bg);
+  },
+
+  /**
+   * @brief Draw text as a QR code with a quiet zone, encoded and drawn in one call.
+   *
+   * @param x Left edge.
+   * @param y Top edge.
+   * @param text Text to encode, up to 134 bytes at the lowest error correction.
+   * @param scale Pixels per module side.
+   * @param ecc Error correction: 0 low, 1 medium, 2 quartile, 3 high.
+   * @return Side of the code in pixels, 0 if the text is too long.
+   */
+  drawQR: function(x, y, text, scale, ecc) {
+    return this._drawQR(this._oled, x, y, text, scale, ecc);
+  },
+
+  /**
+   * @brief Save what is under a rectangle, e.g. before drawing a popup over it.
+   *
+   * @return true if saved.
+   */
+  pushRegion: function(x, y, w, h) {
+    return this._pushRegion(this._oled, x, y, w, h);
+  },
+
+  /**
+   * @brief Put back the rectangle saved last by pushRegion(); call refresh() afterwards.
+   *
+   * @return false if nothing was saved, or while recording a display list or in paged mode.
+   */
+  popRegion: function() {
+    return this._popRegion(this._oled);
+  },
+
+  /**
+   * @brief Keep a copy of what is drawn now under a name, to show it again later.
+   *
+   * @param name Screen name; an earlier screen of the same name is replaced.
+   * @param path File to keep it in, or null to keep it in RAM.
+   * @return true if stored.
+   */
+  storeScreen: function(name, path) {
+    return this._screenStore(this._oled, name, path || null);
+  },
+
+  /**
+   * @brief Switch to a stored screen, sending only the bytes that differ from the panel.
+   *
+   * @param name Screen name.
+   * @param fn Optional function(oled, ud) that draws the fields that change.
+   * @param ud Passed to fn.
+   * @return false if the screen is not stored.
+   */
+  showScreen: function(name, fn, ud) {
+    if (!fn) return this._screenShowPlain(this._oled, name, null, null);
+    return this._screenShow(this._oled, name, fn, ud);
+  },
+
+  /**
+   * @brief Forget a stored screen.
+   */
+  dropScreen: function(name) {
+    this._screenDrop(this._oled, name);
+  },
+
   /**
    * @brief Select active font ID.
    *
@@ -304,6 +1015,16 @@ let SSD1306 = {
   	this._rotateDisplay(this._oled, alt);
   },
 
+  /**
+   * @brief Rotate drawing by 0, 90 or 270 degrees in software; 90 and 270 give a
+   * portrait canvas. Clears the canvas.
+   *
+   * @return true if the rotation was set.
+   */
+  setRotation: function(rotation) {
+    return this._setRotation(this._oled, rotation);
+  },
+
   /**
    * @brief Copy pre-rendered bytes directly into the bitmap.
    *
@@ -0,0 +1,382 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Delta-compressed animations.
+ *
+ * An animation is a keyframe followed by frames that hold only the page bytes that
+ * changed. All values are little endian:
+ *
+ *   header   "SSDA", version (1), width, pages, flags (0),
+ *            frame count (16 bits), frame period in ms (16 bits)
+ *   frame    type: bit 0 clear for a keyframe, set for a delta frame; bit 7 set
+ *            when the frame's byte runs are RLE-coded
+ *   keyframe width * pages bytes, page by page, each page one run
+ *   delta    runs of page, column, length (1 to width) and length bytes;
+ *            a page of 0xff ends the frame
+ *
+ * RLE is PackBits: a code n of 0 to 127 is followed by n + 1 literal bytes, 129 to
+ * 255 by one byte repeated 257 - n times, and 128 is a no-op. Codes do not span runs.
+ *
+ * The player reads the frames in small chunks from a file or a const array and
+ * copies each run into the frame buffer, clipped. When the animation's pages line
+ * up with the panel's, the changed columns are sent straight to the panel, a page
+ * span at a time, with runs close together on a page sent as one span. Otherwise
+ * they are marked dirty and sent by a refresh.
+ */
+
+#include <stdio.h>
+
+#include "mgos_timers.h"
+
+#include "ssd1306_internal.h"
+
+#define ANIM_HEADER_SIZE 12
+#define ANIM_VERSION 1
+#define ANIM_CHUNK 64
+#define ANIM_DELTA 0x01
+#define ANIM_RLE 0x80
+#define ANIM_END 0xff
+#define ANIM_GAP 16             // unchanged bytes cheaper to send than a new column window
+
+struct mgos_ssd1306_anim {
+  struct mgos_ssd1306 *oled;
+  int16_t x;
+  int16_t y;
+  uint8_t width;
+  uint8_t pages;
+  uint16_t frames;
+  uint16_t period;
+  uint16_t frame;               // next frame to show
+  bool loop;
+  bool direct;                  // the current frame's runs go straight to the panel
+  mgos_timer_id timer;
+  uint8_t literal;              // RLE state: literal bytes left
+  uint8_t repeat;               // RLE state: repeats left of value
+  uint8_t value;
+  uint8_t send_page;            // pending span to send or mark dirty
+  int16_t send_left;            // empty when send_right < send_left
+  int16_t send_right;
+  const uint8_t *data;          // source, a const array or a file
+  uint32_t size;
+  uint32_t pos;
+  FILE *fp;
+  uint8_t chunk_pos;
+  uint8_t chunk_len;
+  uint8_t chunk[ANIM_CHUNK];
+};
+
+static int _getc (struct mgos_ssd1306_anim *anim) {
+  if (anim->fp == NULL)
+    return (anim->pos < anim->size) ? anim->data[anim->pos++] : EOF;
+
+  if (anim->chunk_pos == anim->chunk_len) {
+    anim->chunk_len = fread (anim->chunk, 1, sizeof (anim->chunk), anim->fp);
+    anim->chunk_pos = 0;
+    if (anim->chunk_len == 0)
+      return EOF;
+  }
+  return anim->chunk[anim->chunk_pos++];
+}
+
+static int _rle_getc (struct mgos_ssd1306_anim *anim) {
+  int c;
+
+  if (anim->repeat) {
+    anim->repeat--;
+    return anim->value;
+  }
+  if (anim->literal) {
+    anim->literal--;
+    return _getc (anim);
+  }
+  do {
+    c = _getc (anim);
+  } while (c == 128);
+  if (c < 0)
+    return EOF;
+  if (c < 128) {
+    anim->literal = c;
+    return _getc (anim);
+  }
+  anim->repeat = 257 - c - 1;
+  if ((c = _getc (anim)) < 0)
+    return EOF;
+  anim->value = c;
+  return c;
+}
+
+// Copy a frame byte into the frame buffer, clipped; the animation may start at any row
+static void _put (struct mgos_ssd1306_anim *anim, uint8_t page, uint8_t col, uint8_t value) {
+  struct mgos_ssd1306 *oled = anim->oled;
+  int32_t x = anim->x + col, row = anim->y + page * 8;
+  int32_t lo = oled->clip_top - row, hi = oled->clip_bottom - row;
+  int32_t dst_page = (row >= 0) ? row / 8 : (row - 7) / 8;
+  uint8_t shift = row & 7, mask;
+  uint8_t *dst;
+
+  if (x < oled->clip_left || x > oled->clip_right || lo > 7 || hi < 0)
+    return;
+  mask = (uint8_t) (0xff << (lo > 0 ? lo : 0)) & (0xff >> (hi < 7 ? 7 - hi : 0));
+  dst = oled->buffer + dst_page * oled->canvas_width + x;
+  if ((uint8_t) (mask << shift))
+    *dst = (*dst & ~(mask << shift)) | ((value & mask) << shift);
+  if (shift && (mask >> (8 - shift)))
+    dst[oled->canvas_width] = (dst[oled->canvas_width] & ~(mask >> (8 - shift))) | ((value & mask) >> (8 - shift));
+}
+
+// Send the pending span to the panel, or mark it dirty
+static void _flush (struct mgos_ssd1306_anim *anim) {
+  struct mgos_ssd1306 *oled = anim->oled;
+  int32_t left = anim->x + anim->send_left, right = anim->x + anim->send_right;
+  int32_t top = anim->y + anim->send_page * 8;
+
+  if (anim->send_right < anim->send_left)
+    return;
+  anim->send_right = anim->send_left - 1;
+
+  if (left < oled->clip_left)
+    left = oled->clip_left;
+  if (right > oled->clip_right)
+    right = oled->clip_right;
+  if (top + 7 < oled->clip_top || top > oled->clip_bottom || left > right)
+    return;
+
+  if (!anim->direct) {
+    _mark_dirty_clipped (oled, left, (top > oled->clip_top) ? top : oled->clip_top, right,
+                         (top + 7 < oled->clip_bottom) ? top + 7 : oled->clip_bottom);
+    return;
+  }
+  // canvas and panel pages line up; send the part of the span inside the viewport
+  top -= oled->view_y;
+  left -= oled->view_x;
+  right -= oled->view_x;
+  if (top < 0 || top >= oled->height)
+    return;
+  if (left < 0)
+    left = 0;
+  if (right > oled->width - 1)
+    right = oled->width - 1;
+  if (left <= right)
+    ssd1306_write_page (oled, top / 8, left, right - left + 1,
+                        oled->buffer + (oled->view_y + top) / 8 * oled->canvas_width + oled->view_x + left);
+}
+
+// Copy a run of len bytes into the frame buffer and queue its columns for sending
+static bool _run (struct mgos_ssd1306_anim *anim, bool rle, uint8_t page, uint8_t col, uint8_t len) {
+  int c;
+
+  if (page >= anim->pages || len == 0 || col + len > anim->width)
+    return false;
+
+  anim->literal = anim->repeat = 0;
+  for (uint8_t i = 0; i < len; ++i) {
+    if ((c = rle ? _rle_getc (anim) : _getc (anim)) < 0)
+      return false;
+    _put (anim, page, col + i, c);
+  }
+  if (anim->literal || anim->repeat)
+    return false;
+
+  if (anim->send_right < anim->send_left || page != anim->send_page || col < anim->send_left ||
+      col > anim->send_right + 1 + ANIM_GAP) {
+    _flush (anim);
+    anim->send_page = page;
+    anim->send_left = col;
+  }
+  if (anim->send_right < col + len - 1)
+    anim->send_right = col + len - 1;
+  return true;
+}
+
+static bool _frame (struct mgos_ssd1306_anim *anim) {
+  int type = _getc (anim), page, col, len;
+
+  if (type < 0)
+    return false;
+  if (!(type & ANIM_DELTA)) {
+    for (uint8_t p = 0; p < anim->pages; ++p)
+      if (!_run (anim, type & ANIM_RLE, p, 0, anim->width))
+        return false;
+    return true;
+  }
+  while ((page = _getc (anim)) != ANIM_END) {
+    col = _getc (anim);
+    len = _getc (anim);
+    if (page < 0 || col < 0 || len < 0 || !_run (anim, type & ANIM_RLE, page, col, len))
+      return false;
+  }
+  return true;
+}
+
+static bool _header (struct mgos_ssd1306_anim *anim) {
+  uint8_t header[ANIM_HEADER_SIZE];
+  int c;
+
+  for (uint8_t i = 0; i < sizeof (header); ++i) {
+    if ((c = _getc (anim)) < 0)
+      return false;
+    header[i] = c;
+  }
+  if (memcmp (header, "SSDA", 4) != 0 || header[4] != ANIM_VERSION || header[5] == 0 || header[6] == 0)
+    return false;
+  anim->width = header[5];
+  anim->pages = header[6];
+  anim->frames = header[8] | (header[9] << 8);
+  anim->period = header[10] | (header[11] << 8);
+  return true;
+}
+
+static void _timer_cb (void *arg) {
+  struct mgos_ssd1306_anim *anim = (struct mgos_ssd1306_anim *) arg;
+
+  if (anim->frame >= anim->frames && anim->loop)
+    mgos_ssd1306_anim_rewind (anim);
+  if (!mgos_ssd1306_anim_step (anim))
+    mgos_ssd1306_anim_stop (anim);
+}
+
+static struct mgos_ssd1306_anim *_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, const uint8_t *data,
+                                          uint32_t size, FILE *fp) {
+  struct mgos_ssd1306_anim *anim;
+
+  if (oled->frame != NULL) {
+    LOG (LL_ERROR, ("SSD1306 animations need a frame buffer"));
+    return NULL;
+  }
+  if ((anim = calloc (1, sizeof (*anim))) == NULL) {
+    LOG (LL_ERROR, ("SSD1306 animation alloc failed"));
+    return NULL;
+  }
+  anim->oled = oled;
+  anim->x = x;
+  anim->y = y;
+  anim->timer = MGOS_INVALID_TIMER_ID;
+  anim->send_right = anim->send_left - 1;
+  anim->data = data;
+  anim->size = size;
+  anim->fp = fp;
+  if (!_header (anim)) {
+    LOG (LL_ERROR, ("SSD1306 animation header is invalid"));
+    free (anim);
+    return NULL;
+  }
+  return anim;
+}
+
+struct mgos_ssd1306_anim *mgos_ssd1306_anim_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, const uint8_t *data,
+                                                    uint32_t size) {
+  if (oled == NULL || data == NULL)
+    return NULL;
+
+  return _create (oled, x, y, data, size, NULL);
+}
+
+struct mgos_ssd1306_anim *mgos_ssd1306_anim_open (struct mgos_ssd1306 *oled, int16_t x, int16_t y, const char *path) {
+  struct mgos_ssd1306_anim *anim;
+  FILE *fp;
+
+  if (oled == NULL || path == NULL)
+    return NULL;
+  if ((fp = fopen (path, "rb")) == NULL) {
+    LOG (LL_ERROR, ("SSD1306 cannot open %s", path));
+    return NULL;
+  }
+  if ((anim = _create (oled, x, y, NULL, 0, fp)) == NULL)
+    fclose (fp);
+  return anim;
+}
+
+void mgos_ssd1306_anim_free (struct mgos_ssd1306_anim *anim) {
+  if (anim == NULL)
+    return;
+
+  mgos_ssd1306_anim_stop (anim);
+  if (anim->fp != NULL)
+    fclose (anim->fp);
+  free (anim);
+}
+
+bool mgos_ssd1306_anim_step (struct mgos_ssd1306_anim *anim) {
+  struct mgos_ssd1306 *oled;
+  bool ok;
+
+  if (anim == NULL || anim->frame >= anim->frames)
+    return false;
+  oled = anim->oled;
+  if (oled->dlist != NULL) {
+    LOG (LL_ERROR, ("SSD1306 animations cannot be recorded in a display list"));
+    return false;
+  }
+
+  // layers, the gray canvas and portrait mode are sent by refresh, and so is an
+  // animation that does not start on a page boundary of the panel
+  anim->direct = oled->layers == NULL && oled->gray == NULL && oled->target == NULL && !oled->rotation &&
+    (anim->y & 7) == 0 && (oled->view_y & 7) == 0;
+  ok = _frame (anim);
+  _flush (anim);
+  if (ok) {
+    anim->frame++;
+  } else {
+    LOG (LL_ERROR, ("SSD1306 animation frame %u is invalid", anim->frame));
+    anim->frame = anim->frames;
+  }
+  if (!anim->direct)
+    mgos_ssd1306_refresh (oled, false);
+  return ok;
+}
+
+void mgos_ssd1306_anim_rewind (struct mgos_ssd1306_anim *anim) {
+  if (anim == NULL)
+    return;
+
+  anim->frame = 0;
+  anim->pos = ANIM_HEADER_SIZE;
+  if (anim->fp != NULL) {
+    fseek (anim->fp, ANIM_HEADER_SIZE, SEEK_SET);
+    anim->chunk_pos = anim->chunk_len = 0;
+  }
+}
+
+bool mgos_ssd1306_anim_start (struct mgos_ssd1306_anim *anim, bool loop) {
+  if (anim == NULL)
+    return false;
+
+  mgos_ssd1306_anim_stop (anim);
+  anim->loop = loop;
+  anim->timer = mgos_set_timer (anim->period ? anim->period : 1, MGOS_TIMER_REPEAT, _timer_cb, anim);
+  return anim->timer != MGOS_INVALID_TIMER_ID;
+}
+
+void mgos_ssd1306_anim_stop (struct mgos_ssd1306_anim *anim) {
+  if (anim == NULL || anim->timer == MGOS_INVALID_TIMER_ID)
+    return;
+
+  mgos_clear_timer (anim->timer);
+  anim->timer = MGOS_INVALID_TIMER_ID;
+}
+
+uint16_t mgos_ssd1306_anim_get_frame (struct mgos_ssd1306_anim *anim) {
+  return (anim != NULL) ? anim->frame : 0;
+}
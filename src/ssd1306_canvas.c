@@ -0,0 +1,449 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Offscreen canvases and bit-block transfer.
+ *
+ * An offscreen canvas is a 1bpp buffer in the driver's page-major layout. Selecting
+ * one points the driver's drawing buffer, size, clip rectangle and dirty window at
+ * it; the driver's own are kept in the canvas and put back when the driver canvas
+ * is selected again. Every primitive can then draw into it, and display lists and
+ * paged mode are bypassed while it is selected.
+ *
+ * mgos_ssd1306_blit() combines a rectangle of a source canvas into the drawing
+ * buffer with a raster operation. The source and destination rows may have any bit
+ * offset, so each destination byte is merged from the two source bytes of the
+ * column that straddle it: (lo >> shift) | (hi << (8 - shift)). Work is done a
+ * page row at a time, with the rows outside the rectangle masked off: 4 columns
+ * per 32-bit word when the rows have the same alignment, a byte per column
+ * otherwise. Overlapping source and destination areas in the same buffer are
+ * walked in the order that reads each byte before it is overwritten.
+ *
+ * mgos_ssd1306_scroll_region() is a blit of a region of the drawing buffer onto
+ * itself, clipped to the region: vertical offsets carry bits across page bytes,
+ * and horizontal ones move whole page rows with memmove.
+ *
+ * Saved regions keep the whole page bytes under a rectangle, one page row after
+ * another, which makes them a small canvas of their own: saving copies page rows,
+ * and restoring blits the saved canvas back with the rows outside the rectangle
+ * masked off. The driver keeps a stack of saved regions in one allocation that only
+ * grows, for popups that open over each other.
+ */
+
+#include "ssd1306_internal.h"
+
+struct mgos_ssd1306_canvas {
+  uint16_t width;
+  uint16_t height;              // multiple of 8
+  struct mgos_ssd1306 *oled;    // driver drawing into the canvas, NULL when not selected
+  // driver state while the canvas is selected
+  uint8_t *buffer;
+  struct mgos_ssd1306_dlist *dlist;
+  uint16_t canvas_width;
+  uint16_t canvas_height;
+  int16_t clip[4];
+  int16_t refresh[4];
+  uint8_t *pixels;              // word aligned, after the canvas state
+};
+
+struct mgos_ssd1306_canvas *mgos_ssd1306_canvas_create (uint16_t width, uint16_t height) {
+  struct mgos_ssd1306_canvas *canvas;
+  uint32_t size;
+
+  height = (height + 7) & ~7;
+  size = (uint32_t) width * height / 8;
+  if (size == 0 || size > UINT16_MAX) {
+    LOG (LL_ERROR, ("SSD1306 canvas %dx%d is invalid", width, height));
+    return NULL;
+  }
+  if ((canvas = calloc (1, SSD1306_ALIGN (sizeof (*canvas)) + size)) == NULL) {
+    LOG (LL_ERROR, ("SSD1306 canvas alloc failed"));
+    return NULL;
+  }
+  canvas->width = width;
+  canvas->height = height;
+  canvas->pixels = (uint8_t *) canvas + SSD1306_ALIGN (sizeof (*canvas));
+  return canvas;
+}
+
+void mgos_ssd1306_canvas_free (struct mgos_ssd1306_canvas *canvas) {
+  if (canvas == NULL)
+    return;
+
+  if (canvas->oled != NULL)
+    mgos_ssd1306_select_canvas (canvas->oled, NULL);
+  free (canvas);
+}
+
+void mgos_ssd1306_select_canvas (struct mgos_ssd1306 *oled, struct mgos_ssd1306_canvas *canvas) {
+  struct mgos_ssd1306_canvas *target;
+
+  if (oled == NULL || oled->target == canvas)
+    return;
+
+  if ((target = oled->target) != NULL) {
+    oled->buffer = target->buffer;
+    oled->dlist = target->dlist;
+    oled->canvas_width = target->canvas_width;
+    oled->canvas_height = target->canvas_height;
+    oled->clip_left = target->clip[0];
+    oled->clip_top = target->clip[1];
+    oled->clip_right = target->clip[2];
+    oled->clip_bottom = target->clip[3];
+    oled->refresh_left = target->refresh[0];
+    oled->refresh_top = target->refresh[1];
+    oled->refresh_right = target->refresh[2];
+    oled->refresh_bottom = target->refresh[3];
+    target->oled = NULL;
+    oled->target = NULL;
+  }
+  if (canvas == NULL)
+    return;
+  if (canvas->oled != NULL)
+    mgos_ssd1306_select_canvas (canvas->oled, NULL);
+
+  canvas->buffer = oled->buffer;
+  canvas->dlist = oled->dlist;
+  canvas->canvas_width = oled->canvas_width;
+  canvas->canvas_height = oled->canvas_height;
+  canvas->clip[0] = oled->clip_left;
+  canvas->clip[1] = oled->clip_top;
+  canvas->clip[2] = oled->clip_right;
+  canvas->clip[3] = oled->clip_bottom;
+  canvas->refresh[0] = oled->refresh_left;
+  canvas->refresh[1] = oled->refresh_top;
+  canvas->refresh[2] = oled->refresh_right;
+  canvas->refresh[3] = oled->refresh_bottom;
+  canvas->oled = oled;
+  oled->target = canvas;
+  oled->buffer = canvas->pixels;
+  oled->dlist = NULL;
+  oled->canvas_width = canvas->width;
+  oled->canvas_height = canvas->height;
+  _reset_clip (oled);
+}
+
+static inline uint32_t _rop (uint32_t d, uint32_t s, mgos_ssd1306_rop_t rop) {
+  switch (rop) {
+  case SSD1306_ROP_OR:
+    return d | s;
+  case SSD1306_ROP_AND:
+    return d & s;
+  case SSD1306_ROP_XOR:
+    return d ^ s;
+  case SSD1306_ROP_NOT:
+    return ~s;
+  default:
+    return s;
+  }
+}
+
+// Combine n column bytes of one destination page row, under mask; lo and hi are the
+// source page rows above and below the destination page, shifted by shift bits.
+// step is -1 to walk the columns right to left, with the pointers at the last column.
+// Left to right, when the three rows have the same alignment, whole words are
+// shifted at once, with the bits that cross into the next byte masked off.
+static void _row (uint8_t *dst, const uint8_t *lo, const uint8_t *hi, uint16_t n, int8_t step, uint8_t shift, uint8_t mask,
+                  mgos_ssd1306_rop_t rop) {
+  bool words = step > 0 && ((uintptr_t) dst & 3) == ((uintptr_t) lo & 3) && ((uintptr_t) dst & 3) == ((uintptr_t) hi & 3);
+  uint8_t s;
+
+  // whole page rows moved sideways, as in a horizontal scroll
+  if (rop == SSD1306_ROP_COPY && shift == 0 && mask == 0xff) {
+    memmove ((step > 0) ? dst : dst - n + 1, (step > 0) ? lo : lo - n + 1, n);
+    return;
+  }
+
+  for (; n && (!words || ((uintptr_t) dst & 3)); --n, dst += step, lo += step, hi += step) {
+    s = shift ? (*lo >> shift) | (*hi << (8 - shift)) : *lo;
+    *dst = (*dst & ~mask) | (_rop (*dst, s, rop) & mask);
+  }
+  if (words) {
+    uint32_t keep = (0xff >> shift) * 0x01010101u, m = mask * 0x01010101u, sw;
+
+    for (; n >= 4; n -= 4, dst += 4, lo += 4, hi += 4) {
+      ssd1306_word_t *d = (ssd1306_word_t *) dst;
+
+      sw = *(const ssd1306_word_t *) lo;
+      if (shift)
+        sw = ((sw >> shift) & keep) | ((*(const ssd1306_word_t *) hi << (8 - shift)) & ~keep);
+      *d = (*d & ~m) | (_rop (*d, sw, rop) & m);
+    }
+    for (; n; --n, ++dst, ++lo, ++hi) {
+      s = shift ? (*lo >> shift) | (*hi << (8 - shift)) : *lo;
+      *dst = (*dst & ~mask) | (_rop (*dst, s, rop) & mask);
+    }
+  }
+}
+
+// Blit from a buffer in the canvas layout into the drawing buffer, which may be the
+// same buffer
+static void _transfer (struct mgos_ssd1306 *oled, int16_t dx, int16_t dy, const uint8_t *pixels, uint16_t src_width,
+                       uint16_t src_height, int16_t sx, int16_t sy, uint16_t w, uint16_t h, mgos_ssd1306_rop_t rop) {
+  int32_t left, top, right, bottom, delta;
+  int16_t page_start, page_end, page_step;
+  int8_t step;
+
+  // clip the source to its canvas, then the destination to the clip rectangle
+  left = dx;
+  top = dy;
+  right = (int32_t) dx + w - 1;
+  bottom = (int32_t) dy + h - 1;
+  if (sx < 0)
+    left -= sx;
+  if (sy < 0)
+    top -= sy;
+  if ((int32_t) sx + w > src_width)
+    right -= (int32_t) sx + w - src_width;
+  if ((int32_t) sy + h > src_height)
+    bottom -= (int32_t) sy + h - src_height;
+  if (left < oled->clip_left)
+    left = oled->clip_left;
+  if (top < oled->clip_top)
+    top = oled->clip_top;
+  if (right > oled->clip_right)
+    right = oled->clip_right;
+  if (bottom > oled->clip_bottom)
+    bottom = oled->clip_bottom;
+  if (left > right || top > bottom)
+    return;
+
+  // destination row y comes from source row y - delta
+  delta = (int32_t) dy - sy;
+  page_start = (delta > 0) ? bottom / 8 : top / 8;
+  page_end = (delta > 0) ? top / 8 : bottom / 8;
+  page_step = (delta > 0) ? -1 : 1;
+  step = (dx > sx) ? -1 : 1;
+  for (int16_t page = page_start;; page += page_step) {
+    int32_t row = page * 8 - delta;
+    int32_t src_page = (row >= 0) ? row / 8 : (row - 7) / 8;
+    int32_t first = (step > 0) ? left : right;
+    uint8_t mask = 0xff;
+    const uint8_t *lo, *hi;
+
+    if (page * 8 < top)
+      mask &= 0xff << (top - page * 8);
+    if (page * 8 + 7 > bottom)
+      mask &= 0xff >> (page * 8 + 7 - bottom);
+    // a source page outside the canvas only feeds masked rows; read a valid one instead
+    lo = pixels + ((src_page < 0) ? src_page + 1 : src_page) * src_width;
+    hi = (src_page + 1 < src_height / 8) ? pixels + (src_page + 1) * src_width : lo;
+    _row (oled->buffer + page * oled->canvas_width + first, lo + first - (dx - sx), hi + first - (dx - sx),
+          right - left + 1, step, row & 7, mask, rop);
+    if (page == page_end)
+      break;
+  }
+  _mark_dirty (oled, left, top, right, bottom);
+}
+
+void mgos_ssd1306_blit (struct mgos_ssd1306 *oled, int16_t dx, int16_t dy, const struct mgos_ssd1306_canvas *src, int16_t sx,
+                        int16_t sy, uint16_t w, uint16_t h, mgos_ssd1306_rop_t rop) {
+  if (oled == NULL || w == 0 || h == 0)
+    return;
+  if (oled->dlist != NULL) {
+    LOG (LL_ERROR, ("SSD1306 blit needs a frame buffer and cannot be recorded in a display list"));
+    return;
+  }
+  if (src == NULL && oled->frame != NULL) {
+    LOG (LL_ERROR, ("SSD1306 has no frame buffer to blit from"));
+    return;
+  }
+
+  if (src != NULL)
+    _transfer (oled, dx, dy, src->pixels, src->width, src->height, sx, sy, w, h, rop);
+  else if (oled->target != NULL)
+    // the driver's canvas, wherever the drawing buffer points
+    _transfer (oled, dx, dy, _canvas (oled), oled->target->canvas_width, oled->target->canvas_height, sx, sy, w, h, rop);
+  else
+    _transfer (oled, dx, dy, _canvas (oled), oled->canvas_width, oled->canvas_height, sx, sy, w, h, rop);
+}
+
+void mgos_ssd1306_scroll_region (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h, int16_t dx,
+                                 int16_t dy, mgos_ssd1306_color_t fill) {
+  int16_t clip[4];
+  int32_t left = x, top = y, right = (int32_t) x + w - 1, bottom = (int32_t) y + h - 1;
+
+  if (oled == NULL || w == 0 || h == 0)
+    return;
+  if (oled->dlist != NULL) {
+    LOG (LL_ERROR, ("SSD1306 scroll needs a frame buffer and cannot be recorded in a display list"));
+    return;
+  }
+
+  if (left < oled->clip_left)
+    left = oled->clip_left;
+  if (top < oled->clip_top)
+    top = oled->clip_top;
+  if (right > oled->clip_right)
+    right = oled->clip_right;
+  if (bottom > oled->clip_bottom)
+    bottom = oled->clip_bottom;
+  if (left > right || top > bottom)
+    return;
+  w = right - left + 1;
+  h = bottom - top + 1;
+
+  // move the region within itself, clipped to it, then fill what was uncovered
+  clip[0] = oled->clip_left;
+  clip[1] = oled->clip_top;
+  clip[2] = oled->clip_right;
+  clip[3] = oled->clip_bottom;
+  oled->clip_left = left;
+  oled->clip_top = top;
+  oled->clip_right = right;
+  oled->clip_bottom = bottom;
+  if (dx > -w && dx < w && dy > -h && dy < h) {
+    _transfer (oled, left + dx, top + dy, oled->buffer, oled->canvas_width, oled->canvas_height, left, top, w, h,
+               SSD1306_ROP_COPY);
+    // uncovered columns, then the uncovered rows of the other columns
+    if (dx > 0)
+      mgos_ssd1306_fill_rectangle (oled, left, top, dx, h, fill);
+    else if (dx < 0)
+      mgos_ssd1306_fill_rectangle (oled, right + dx + 1, top, -dx, h, fill);
+    if (dy > 0)
+      mgos_ssd1306_fill_rectangle (oled, (dx > 0) ? left + dx : left, top, w - abs (dx), dy, fill);
+    else if (dy < 0)
+      mgos_ssd1306_fill_rectangle (oled, (dx > 0) ? left + dx : left, bottom + dy + 1, w - abs (dx), -dy, fill);
+  } else {
+    mgos_ssd1306_fill_rectangle (oled, left, top, w, h, fill);
+  }
+  oled->clip_left = clip[0];
+  oled->clip_top = clip[1];
+  oled->clip_right = clip[2];
+  oled->clip_bottom = clip[3];
+  _mark_dirty (oled, left, top, right, bottom);
+}
+
+// Pages of a region, from the one holding its top row
+static inline int16_t _page_of (int32_t y) {
+  return (y >= 0) ? y / 8 : (y - 7) / 8;
+}
+
+uint32_t mgos_ssd1306_region_size (int16_t y, uint16_t w, uint16_t h) {
+  if (w == 0 || h == 0)
+    return 0;
+
+  return (uint32_t) w * (_page_of ((int32_t) y + h - 1) - _page_of (y) + 1);
+}
+
+void mgos_ssd1306_save_region (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h, uint8_t *buffer) {
+  int32_t left = (x > 0) ? x : 0, right = (int32_t) x + w - 1;
+  int16_t page0 = _page_of (y), page_start, page_end;
+
+  if (oled == NULL || buffer == NULL || w == 0 || h == 0)
+    return;
+  if (oled->dlist != NULL) {
+    LOG (LL_ERROR, ("SSD1306 saving a region needs a frame buffer"));
+    return;
+  }
+
+  // the part on the canvas, the rest of the buffer is left alone
+  if (right > oled->canvas_width - 1)
+    right = oled->canvas_width - 1;
+  page_start = (page0 > 0) ? page0 : 0;
+  page_end = _page_of ((int32_t) y + h - 1);
+  if (page_end > oled->canvas_height / 8 - 1)
+    page_end = oled->canvas_height / 8 - 1;
+  for (int16_t page = page_start; page <= page_end && left <= right; ++page)
+    ssd1306_copy_bytes (buffer + (uint32_t) (page - page0) * w + (left - x), oled->buffer + page * oled->canvas_width + left,
+                        right - left + 1);
+}
+
+void mgos_ssd1306_restore_region (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                  const uint8_t *buffer) {
+  int16_t clip[4];
+  int16_t page0 = _page_of (y);
+
+  if (oled == NULL || buffer == NULL || w == 0 || h == 0)
+    return;
+  if (oled->dlist != NULL) {
+    LOG (LL_ERROR, ("SSD1306 restoring a region needs a frame buffer"));
+    return;
+  }
+
+  // the saved pages are a canvas w wide, the region starting at its row y - page0 * 8
+  clip[0] = oled->clip_left;
+  clip[1] = oled->clip_top;
+  clip[2] = oled->clip_right;
+  clip[3] = oled->clip_bottom;
+  _reset_clip (oled);
+  _transfer (oled, x, y, buffer, w, mgos_ssd1306_region_size (y, w, h) / w * 8, 0, y - page0 * 8, w, h, SSD1306_ROP_COPY);
+  oled->clip_left = clip[0];
+  oled->clip_top = clip[1];
+  oled->clip_right = clip[2];
+  oled->clip_bottom = clip[3];
+}
+
+// Saved region stack entries: the pages, followed by where they came from
+typedef struct {
+  int16_t x;
+  int16_t y;
+  uint16_t w;
+  uint16_t h;
+} saved_region_t;
+
+bool mgos_ssd1306_push_region (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h) {
+  saved_region_t region = { x, y, w, h };
+  uint32_t size = mgos_ssd1306_region_size (y, w, h), len;
+
+  if (oled == NULL || size == 0)
+    return false;
+  if (oled->dlist != NULL) {
+    LOG (LL_ERROR, ("SSD1306 saving a region needs a frame buffer"));
+    return false;
+  }
+
+  len = oled->saved_len + size + sizeof (region);
+  if (len > oled->saved_size) {
+    uint8_t *saved = realloc (oled->saved, len);
+
+    if (saved == NULL) {
+      LOG (LL_ERROR, ("SSD1306 out of memory saving a region"));
+      return false;
+    }
+    oled->saved = saved;
+    oled->saved_size = len;
+  }
+  mgos_ssd1306_save_region (oled, x, y, w, h, oled->saved + oled->saved_len);
+  memcpy (oled->saved + len - sizeof (region), &region, sizeof (region));
+  oled->saved_len = len;
+  return true;
+}
+
+bool mgos_ssd1306_pop_region (struct mgos_ssd1306 *oled) {
+  saved_region_t region;
+
+  if (oled == NULL || oled->saved_len == 0)
+    return false;
+  if (oled->dlist != NULL) {
+    // keep the region until it can be put back
+    LOG (LL_ERROR, ("SSD1306 restoring a region needs a frame buffer"));
+    return false;
+  }
+
+  memcpy (&region, oled->saved + oled->saved_len - sizeof (region), sizeof (region));
+  oled->saved_len -= sizeof (region) + mgos_ssd1306_region_size (region.y, region.w, region.h);
+  mgos_ssd1306_restore_region (oled, region.x, region.y, region.w, region.h, oled->saved + oled->saved_len);
+  return true;
+}
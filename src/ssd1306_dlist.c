@@ -0,0 +1,617 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Display lists.
+ *
+ * While a list is being recorded, drawing calls are appended to a command buffer
+ * instead of touching the canvas; each command carries the canvas bounding box of
+ * everything it may draw. Ending the recording compares the new commands with the
+ * ones that produced the current canvas, position by position. Commands that were
+ * added, removed or changed damage their old and new bounding boxes; the damaged
+ * rectangles are merged, cleared and redrawn with the clip rectangle set to each of
+ * them, replaying only the commands that overlap it. Unchanged parts of the canvas
+ * are neither redrawn nor marked dirty, so the next refresh only sends what changed.
+ *
+ * Without a frame buffer (paged mode) the driver records all drawing into a list of
+ * its own, emptied by clear. Refresh renders the damaged part of each page into a
+ * single scratch page, which the drawing code addresses as if it were that page of
+ * the canvas, and sends it before moving on to the next page.
+ */
+
+#include "ssd1306_internal.h"
+
+// Damaged rectangles are merged once there are more than this many
+#define DL_MAX_DAMAGE 8
+
+// First allocation of a command buffer; buffers double when full
+#define DL_INITIAL_SIZE 256
+
+typedef struct {
+  uint8_t op;                   // ssd1306_dl_op_t
+  uint8_t font;                 // font index of text commands, 0 otherwise
+  uint16_t size;                // record size in bytes, header included, always even
+  int16_t left;                 // bounding box, inclusive canvas coordinates
+  int16_t top;
+  int16_t right;
+  int16_t bottom;
+  // followed by the scalar arguments and the point array or string
+} dl_cmd_t;
+
+typedef struct {
+  int16_t left;
+  int16_t top;
+  int16_t right;
+  int16_t bottom;
+} dl_rect_t;
+
+struct mgos_ssd1306_dlist {
+  uint8_t *cmds;                // commands being recorded
+  uint32_t len;
+  uint32_t size;
+  uint8_t *prev;                // commands that produced the current canvas
+  uint32_t prev_len;
+  uint32_t prev_size;
+  struct mgos_ssd1306 *owner;   // driver whose canvas holds the previous frame
+  bool overflow;                // recording ran out of memory or met a command too large
+};
+
+// Number of scalar arguments of each command
+static const uint8_t s_nargs[] = {
+  [SSD1306_DL_PIXEL] = 3,
+  [SSD1306_DL_PIXELS] = 1,
+  [SSD1306_DL_HLINE] = 4,
+  [SSD1306_DL_VLINE] = 4,
+  [SSD1306_DL_LINE] = 5,
+  [SSD1306_DL_POLYLINE] = 1,
+  [SSD1306_DL_RECTANGLE] = 5,
+  [SSD1306_DL_FILL_RECTANGLE] = 5,
+  [SSD1306_DL_CIRCLE] = 4,
+  [SSD1306_DL_ELLIPSE] = 5,
+  [SSD1306_DL_FILL_ELLIPSE] = 5,
+  [SSD1306_DL_ROUND_RECTANGLE] = 6,
+  [SSD1306_DL_FILL_ROUND_RECTANGLE] = 6,
+  [SSD1306_DL_ARC] = 7,
+  [SSD1306_DL_POLYGON] = 1,
+  [SSD1306_DL_TRIANGLE] = 7,
+  [SSD1306_DL_CHAR] = 5,
+  [SSD1306_DL_STRING] = 4,
+  [SSD1306_DL_BITMAP] = 6,
+  [SSD1306_DL_CLIP] = 4,
+};
+
+// points may come unaligned from the mJS FFI, so each one is copied out
+static void _points_bbox (const mgos_ssd1306_point_t *points, uint16_t count, int32_t *box) {
+  for (uint16_t i = 0; i < count; ++i) {
+    mgos_ssd1306_point_t p;
+
+    memcpy (&p, &points[i], sizeof (p));
+    if (box[0] > p.x)
+      box[0] = p.x;
+    if (box[1] > p.y)
+      box[1] = p.y;
+    if (box[2] < p.x)
+      box[2] = p.x;
+    if (box[3] < p.y)
+      box[3] = p.y;
+  }
+}
+
+// Bounding box of everything a command may draw, clipped to the clip rectangle;
+// returns false if the command cannot draw anything
+static bool _bbox (struct mgos_ssd1306 *oled, ssd1306_dl_op_t op, const int16_t *a, const void *data, uint32_t len,
+                   dl_cmd_t *cmd) {
+  int32_t box[4] = { INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN };
+  char str[2];
+
+  switch (op) {
+  case SSD1306_DL_PIXEL:
+    box[0] = box[2] = a[0];
+    box[1] = box[3] = a[1];
+    break;
+  case SSD1306_DL_PIXELS:
+  case SSD1306_DL_POLYLINE:
+  case SSD1306_DL_POLYGON:
+    _points_bbox ((const mgos_ssd1306_point_t *) data, len / sizeof (mgos_ssd1306_point_t), box);
+    break;
+  case SSD1306_DL_HLINE:
+    box[0] = a[0];
+    box[1] = box[3] = a[1];
+    box[2] = (int32_t) a[0] + (uint16_t) a[2] - 1;
+    break;
+  case SSD1306_DL_VLINE:
+    box[0] = box[2] = a[0];
+    box[1] = a[1];
+    box[3] = (int32_t) a[1] + (uint16_t) a[2] - 1;
+    break;
+  case SSD1306_DL_LINE:
+  case SSD1306_DL_TRIANGLE:
+    _points_bbox ((const mgos_ssd1306_point_t *) a, (op == SSD1306_DL_LINE) ? 2 : 3, box);
+    break;
+  case SSD1306_DL_RECTANGLE: {
+    // the far edges are drawn at int16_t positions, which wrap for oversized rectangles
+    const mgos_ssd1306_point_t corners[2] = {
+      { a[0], a[1] },
+      { a[0] + (uint16_t) a[2] - 1, a[1] + (uint16_t) a[3] - 1 },
+    };
+    box[2] = (int32_t) a[0] + (uint16_t) a[2] - 1;
+    box[3] = (int32_t) a[1] + (uint16_t) a[3] - 1;
+    _points_bbox (corners, 2, box);
+    break;
+  }
+  case SSD1306_DL_FILL_RECTANGLE:
+  case SSD1306_DL_ROUND_RECTANGLE:
+  case SSD1306_DL_FILL_ROUND_RECTANGLE:
+  case SSD1306_DL_BITMAP:
+    box[0] = a[0];
+    box[1] = a[1];
+    box[2] = (int32_t) a[0] + (uint16_t) a[2] - 1;
+    box[3] = (int32_t) a[1] + (uint16_t) a[3] - 1;
+    break;
+  case SSD1306_DL_CIRCLE:
+  case SSD1306_DL_ARC:
+    box[0] = (int32_t) a[0] - (uint16_t) a[2];
+    box[1] = (int32_t) a[1] - (uint16_t) a[2];
+    box[2] = (int32_t) a[0] + (uint16_t) a[2];
+    box[3] = (int32_t) a[1] + (uint16_t) a[2];
+    break;
+  case SSD1306_DL_ELLIPSE:
+  case SSD1306_DL_FILL_ELLIPSE:
+    box[0] = (int32_t) a[0] - (uint16_t) a[2];
+    box[1] = (int32_t) a[1] - (uint16_t) a[3];
+    box[2] = (int32_t) a[0] + (uint16_t) a[2];
+    box[3] = (int32_t) a[1] + (uint16_t) a[3];
+    break;
+  case SSD1306_DL_CHAR:
+  case SSD1306_DL_STRING:
+    if (op == SSD1306_DL_CHAR) {
+      str[0] = a[2];
+      str[1] = '\0';
+      data = str;
+    }
+    box[0] = a[0];
+    box[1] = a[1];
+    box[2] = (int32_t) a[0] + mgos_ssd1306_measure_string (oled, data) - 1;
+    box[3] = (int32_t) a[1] + oled->font->height - 1;
+    break;
+  case SSD1306_DL_CLIP:
+    // draws nothing, see ssd1306_dl_record
+    break;
+  }
+
+  if (box[0] < oled->clip_left)
+    box[0] = oled->clip_left;
+  if (box[1] < oled->clip_top)
+    box[1] = oled->clip_top;
+  if (box[2] > oled->clip_right)
+    box[2] = oled->clip_right;
+  if (box[3] > oled->clip_bottom)
+    box[3] = oled->clip_bottom;
+  if (box[0] > box[2] || box[1] > box[3])
+    return false;
+
+  cmd->left = box[0];
+  cmd->top = box[1];
+  cmd->right = box[2];
+  cmd->bottom = box[3];
+  return true;
+}
+
+static bool _reserve (struct mgos_ssd1306_dlist *dl, uint32_t size) {
+  uint32_t new_size = dl->size ? dl->size : DL_INITIAL_SIZE;
+  uint8_t *cmds;
+
+  if (dl->len + size <= dl->size)
+    return true;
+  while (new_size < dl->len + size)
+    new_size *= 2;
+  cmds = realloc (dl->cmds, new_size);
+  if (cmds == NULL)
+    return false;
+  dl->cmds = cmds;
+  dl->size = new_size;
+  return true;
+}
+
+void ssd1306_dl_record (struct mgos_ssd1306 *oled, ssd1306_dl_op_t op, const int16_t *args, const void *data, uint32_t len) {
+  struct mgos_ssd1306_dlist *dl = oled->dlist;
+  uint16_t nargs = s_nargs[op];
+  dl_cmd_t cmd = { 0 };
+  uint32_t size;
+  uint8_t *dst;
+
+  if (dl->overflow)
+    return;
+  // commands carry their size in 16 bits, so bigger payloads cannot be recorded
+  size = (sizeof (cmd) + nargs * sizeof (int16_t) + len + 1) & ~1;
+  if (size > UINT16_MAX) {
+    LOG (LL_ERROR, ("Display list command too large"));
+    dl->overflow = true;
+    return;
+  }
+  if (op == SSD1306_DL_CLIP) {
+    // draws nothing by itself; the boxes of the commands after it are clipped
+    cmd.right = -1;
+    cmd.bottom = -1;
+  } else if (!_bbox (oled, op, args, data, len, &cmd)) {
+    return;
+  }
+
+  if (!_reserve (dl, size)) {
+    LOG (LL_ERROR, ("Out of memory recording display list"));
+    dl->overflow = true;
+    return;
+  }
+
+  cmd.op = op;
+  cmd.size = size;
+  if (op == SSD1306_DL_CHAR || op == SSD1306_DL_STRING) {
+    for (uint8_t i = 0; i < NUM_FONTS; ++i) {
+      if (fonts[i] == oled->font)
+        cmd.font = i;
+    }
+  }
+  dst = dl->cmds + dl->len;
+  memcpy (dst, &cmd, sizeof (cmd));
+  memcpy (dst + sizeof (cmd), args, nargs * sizeof (int16_t));
+  if (len)
+    memcpy (dst + sizeof (cmd) + nargs * sizeof (int16_t), data, len);
+  if (size > sizeof (cmd) + nargs * sizeof (int16_t) + len)
+    dst[size - 1] = 0;
+  dl->len += size;
+}
+
+// Run a recorded command against the canvas; base is the clip rectangle of the replay
+static void _replay (struct mgos_ssd1306 *oled, const dl_cmd_t *cmd, const int16_t *base) {
+  const int16_t *a = (const int16_t *) (cmd + 1);
+  const void *data = a + s_nargs[cmd->op];
+  uint16_t count = (cmd->size - sizeof (*cmd) - s_nargs[cmd->op] * sizeof (int16_t)) / sizeof (mgos_ssd1306_point_t);
+  const font_info_t *font = oled->font;
+
+  switch (cmd->op) {
+  case SSD1306_DL_PIXEL:
+    mgos_ssd1306_draw_pixel (oled, a[0], a[1], a[2]);
+    break;
+  case SSD1306_DL_PIXELS:
+    mgos_ssd1306_draw_pixels (oled, data, count, a[0]);
+    break;
+  case SSD1306_DL_HLINE:
+    mgos_ssd1306_draw_hline (oled, a[0], a[1], a[2], a[3]);
+    break;
+  case SSD1306_DL_VLINE:
+    mgos_ssd1306_draw_vline (oled, a[0], a[1], a[2], a[3]);
+    break;
+  case SSD1306_DL_LINE:
+    mgos_ssd1306_draw_line (oled, a[0], a[1], a[2], a[3], a[4]);
+    break;
+  case SSD1306_DL_POLYLINE:
+    mgos_ssd1306_draw_polyline (oled, data, count, a[0]);
+    break;
+  case SSD1306_DL_RECTANGLE:
+    mgos_ssd1306_draw_rectangle (oled, a[0], a[1], a[2], a[3], a[4]);
+    break;
+  case SSD1306_DL_FILL_RECTANGLE:
+    mgos_ssd1306_fill_rectangle (oled, a[0], a[1], a[2], a[3], a[4]);
+    break;
+  case SSD1306_DL_CIRCLE:
+    mgos_ssd1306_draw_circle (oled, a[0], a[1], a[2], a[3]);
+    break;
+  case SSD1306_DL_ELLIPSE:
+    mgos_ssd1306_draw_ellipse (oled, a[0], a[1], a[2], a[3], a[4]);
+    break;
+  case SSD1306_DL_FILL_ELLIPSE:
+    mgos_ssd1306_fill_ellipse (oled, a[0], a[1], a[2], a[3], a[4]);
+    break;
+  case SSD1306_DL_ROUND_RECTANGLE:
+    mgos_ssd1306_draw_round_rectangle (oled, a[0], a[1], a[2], a[3], a[4], a[5]);
+    break;
+  case SSD1306_DL_FILL_ROUND_RECTANGLE:
+    mgos_ssd1306_fill_round_rectangle (oled, a[0], a[1], a[2], a[3], a[4], a[5]);
+    break;
+  case SSD1306_DL_ARC:
+    mgos_ssd1306_draw_arc (oled, a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+    break;
+  case SSD1306_DL_POLYGON:
+    mgos_ssd1306_fill_polygon (oled, data, count, a[0]);
+    break;
+  case SSD1306_DL_TRIANGLE:
+    mgos_ssd1306_fill_triangle (oled, a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+    break;
+  case SSD1306_DL_CHAR:
+    oled->font = fonts[cmd->font];
+    mgos_ssd1306_draw_char (oled, a[0], a[1], a[2], a[3], a[4]);
+    oled->font = font;
+    break;
+  case SSD1306_DL_STRING:
+    oled->font = fonts[cmd->font];
+    mgos_ssd1306_draw_string_color (oled, a[0], a[1], data, a[2], a[3]);
+    oled->font = font;
+    break;
+  case SSD1306_DL_BITMAP:
+    mgos_ssd1306_draw_bitmap (oled, a[0], a[1], a[2], a[3], data, a[4], a[5]);
+    break;
+  case SSD1306_DL_CLIP:
+    oled->clip_left = (a[0] > base[0]) ? a[0] : base[0];
+    oled->clip_top = (a[1] > base[1]) ? a[1] : base[1];
+    oled->clip_right = (a[2] < base[2]) ? a[2] : base[2];
+    oled->clip_bottom = (a[3] < base[3]) ? a[3] : base[3];
+    break;
+  }
+}
+
+static inline bool _touches (const dl_rect_t *a, const dl_rect_t *b) {
+  return a->left <= b->right + 1 && b->left <= a->right + 1 && a->top <= b->bottom + 1 && b->top <= a->bottom + 1;
+}
+
+static inline void _union (dl_rect_t *a, const dl_rect_t *b) {
+  if (a->left > b->left)
+    a->left = b->left;
+  if (a->top > b->top)
+    a->top = b->top;
+  if (a->right < b->right)
+    a->right = b->right;
+  if (a->bottom < b->bottom)
+    a->bottom = b->bottom;
+}
+
+static inline int32_t _area (const dl_rect_t *r) {
+  return (int32_t) (r->right - r->left + 1) * (r->bottom - r->top + 1);
+}
+
+// Add a rectangle to the damage set, merging it with every rectangle it touches.
+// When the set is full, the rectangle goes to the one that grows the least.
+static void _add_damage (dl_rect_t *damage, uint8_t *count, const dl_cmd_t *cmd) {
+  dl_rect_t r = { cmd->left, cmd->top, cmd->right, cmd->bottom };
+  uint8_t i;
+
+  if (r.right < r.left)
+    return;
+
+again:
+  for (i = 0; i < *count; ++i) {
+    if (_touches (&damage[i], &r)) {
+      _union (&r, &damage[i]);
+      damage[i] = damage[--*count];
+      goto again;
+    }
+  }
+  if (*count == DL_MAX_DAMAGE) {
+    int32_t best = INT32_MAX;
+    uint8_t merge = 0;
+
+    for (i = 0; i < *count; ++i) {
+      dl_rect_t u = damage[i];
+      _union (&u, &r);
+      if (_area (&u) - _area (&damage[i]) < best) {
+        best = _area (&u) - _area (&damage[i]);
+        merge = i;
+      }
+    }
+    _union (&r, &damage[merge]);
+    damage[merge] = damage[--*count];
+    goto again;
+  }
+  damage[(*count)++] = r;
+}
+
+// Replay the commands that overlap the clip rectangle
+static void _replay_clip (struct mgos_ssd1306 *oled, const struct mgos_ssd1306_dlist *dl) {
+  const int16_t base[4] = { oled->clip_left, oled->clip_top, oled->clip_right, oled->clip_bottom };
+
+  for (uint32_t pos = 0; pos < dl->len;) {
+    const dl_cmd_t *cmd = (const dl_cmd_t *) (dl->cmds + pos);
+
+    if (cmd->op == SSD1306_DL_CLIP || (cmd->left <= oled->clip_right && cmd->right >= oled->clip_left &&
+                                       cmd->top <= oled->clip_bottom && cmd->bottom >= oled->clip_top))
+      _replay (oled, cmd, base);
+    pos += cmd->size;
+  }
+}
+
+// Clear each damaged rectangle of the canvas and redraw the commands that overlap it
+static void _redraw (struct mgos_ssd1306 *oled, const struct mgos_ssd1306_dlist *dl, const dl_rect_t *damage, uint8_t count) {
+  for (uint8_t i = 0; i < count; ++i) {
+    const dl_rect_t *r = &damage[i];
+
+    oled->clip_left = r->left;
+    oled->clip_top = r->top;
+    oled->clip_right = r->right;
+    oled->clip_bottom = r->bottom;
+    mgos_ssd1306_fill_rectangle (oled, r->left, r->top, r->right - r->left + 1, r->bottom - r->top + 1, SSD1306_COLOR_BLACK);
+    _replay_clip (oled, dl);
+  }
+}
+
+// Paged mode: render every page that holds damage into the scratch page and send
+// it right away. A page is rendered over the columns spanned by its damage, all
+// eight rows of them, since nothing else is known about the bytes being replaced.
+static void _stream (struct mgos_ssd1306 *oled, const struct mgos_ssd1306_dlist *dl, const dl_rect_t *damage, uint8_t count) {
+  for (int16_t top = 0; top < oled->canvas_height; top += 8) {
+    int16_t left = INT16_MAX, right = -1;
+
+    for (uint8_t i = 0; i < count; ++i) {
+      if (damage[i].top <= top + 7 && damage[i].bottom >= top) {
+        if (left > damage[i].left)
+          left = damage[i].left;
+        if (right < damage[i].right)
+          right = damage[i].right;
+      }
+    }
+    if (right < 0)
+      continue;
+
+    // the drawing code addresses the canvas, so point its page at the scratch page
+    memset (oled->line + left, 0, right - left + 1);
+    oled->buffer = (uint8_t *) ((uintptr_t) oled->line - (uintptr_t) (top / 8) * oled->canvas_width);
+    oled->clip_left = left;
+    oled->clip_top = top;
+    oled->clip_right = right;
+    oled->clip_bottom = top + 7;
+    _replay_clip (oled, dl);
+    ssd1306_write_page (oled, top / 8, left, right - left + 1, oled->line + left);
+  }
+  oled->buffer = NULL;
+  _reset_dirty (oled);
+}
+
+// Damage between the commands that produced the canvas and the recorded ones
+static uint8_t _damage (struct mgos_ssd1306 *oled, const struct mgos_ssd1306_dlist *dl, bool full, dl_rect_t *damage) {
+  uint32_t a = 0, b = 0;
+  uint8_t count = 0;
+
+  if (full || dl->owner != oled || oled->shown != dl || dl->overflow) {
+    // nothing is known about the canvas, redraw all of it
+    damage[0].left = 0;
+    damage[0].top = 0;
+    damage[0].right = oled->canvas_width - 1;
+    damage[0].bottom = oled->canvas_height - 1;
+    return 1;
+  }
+
+  while (a < dl->prev_len || b < dl->len) {
+    const dl_cmd_t *old = (a < dl->prev_len) ? (const dl_cmd_t *) (dl->prev + a) : NULL;
+    const dl_cmd_t *cur = (b < dl->len) ? (const dl_cmd_t *) (dl->cmds + b) : NULL;
+
+    if (old == NULL || cur == NULL || old->size != cur->size || memcmp (old, cur, old->size) != 0) {
+      if (old != NULL)
+        _add_damage (damage, &count, old);
+      if (cur != NULL)
+        _add_damage (damage, &count, cur);
+    }
+    if (old != NULL)
+      a += old->size;
+    if (cur != NULL)
+      b += cur->size;
+  }
+  return count;
+}
+
+// Bring the canvas, or in paged mode the screen, up to date with the recorded commands
+static void _render (struct mgos_ssd1306 *oled, struct mgos_ssd1306_dlist *dl, bool full) {
+  dl_rect_t damage[DL_MAX_DAMAGE];
+  uint8_t count = _damage (oled, dl, full, damage);
+  int16_t clip[4] = { oled->clip_left, oled->clip_top, oled->clip_right, oled->clip_bottom };
+  struct mgos_ssd1306_dlist *recording = oled->dlist;
+
+  oled->dlist = NULL;
+  if (oled->frame != NULL)
+    _stream (oled, dl, damage, count);
+  else
+    _redraw (oled, dl, damage, count);
+  oled->dlist = recording;
+  oled->clip_left = clip[0];
+  oled->clip_top = clip[1];
+  oled->clip_right = clip[2];
+  oled->clip_bottom = clip[3];
+
+  // a partial recording leaves the canvas incomplete, so the next frame starts over
+  dl->owner = dl->overflow ? NULL : oled;
+  oled->shown = dl;
+}
+
+struct mgos_ssd1306_dlist *mgos_ssd1306_dlist_create (void) {
+  return calloc (1, sizeof (struct mgos_ssd1306_dlist));
+}
+
+void mgos_ssd1306_dlist_free (struct mgos_ssd1306_dlist *dl) {
+  if (dl == NULL)
+    return;
+
+  free (dl->cmds);
+  free (dl->prev);
+  free (dl);
+}
+
+void mgos_ssd1306_dlist_invalidate (struct mgos_ssd1306_dlist *dl) {
+  if (dl == NULL)
+    return;
+
+  dl->owner = NULL;
+}
+
+void mgos_ssd1306_dlist_begin (struct mgos_ssd1306 *oled, struct mgos_ssd1306_dlist *dl) {
+  if (oled == NULL || dl == NULL)
+    return;
+  if (oled->frame != NULL) {
+    // the panel shows the driver's own list, which a second list would overwrite
+    LOG (LL_ERROR, ("SSD1306 display lists are not available in paged mode"));
+    return;
+  }
+
+  dl->len = 0;
+  dl->overflow = false;
+  _reset_clip (oled);
+  oled->dlist = dl;
+}
+
+void mgos_ssd1306_dlist_end (struct mgos_ssd1306 *oled) {
+  struct mgos_ssd1306_dlist *dl;
+  uint8_t *t;
+  uint32_t s;
+
+  if (oled == NULL || oled->dlist == NULL || oled->dlist == oled->frame)
+    return;
+
+  dl = oled->dlist;
+  oled->dlist = oled->frame;
+  _render (oled, dl, false);
+
+  // the new commands now describe the canvas; keep the old buffer for the next frame
+  t = dl->prev;
+  dl->prev = dl->cmds;
+  dl->cmds = t;
+  s = dl->prev_size;
+  dl->prev_size = dl->size;
+  dl->size = s;
+  dl->prev_len = dl->len;
+  dl->len = 0;
+}
+
+void ssd1306_dl_clear (struct mgos_ssd1306 *oled) {
+  _reset_clip (oled);
+  oled->frame->len = 0;
+  oled->frame->overflow = false;
+}
+
+void ssd1306_dl_refresh (struct mgos_ssd1306 *oled, bool force) {
+  struct mgos_ssd1306_dlist *dl = oled->frame;
+
+  _render (oled, dl, force);
+
+  // drawing goes on from the current contents, so keep a copy of them
+  if (dl->prev_size < dl->len) {
+    uint8_t *prev = realloc (dl->prev, dl->size);
+
+    if (prev == NULL) {
+      LOG (LL_ERROR, ("Out of memory keeping display list"));
+      dl->owner = NULL;
+      return;
+    }
+    dl->prev = prev;
+    dl->prev_size = dl->size;
+  }
+  if (dl->len)
+    memcpy (dl->prev, dl->cmds, dl->len);
+  dl->prev_len = dl->len;
+}
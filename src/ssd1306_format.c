@@ -0,0 +1,293 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Number and formatted text output without a string buffer.
+ *
+ * Characters go to a pen as they are produced. Left aligned text is drawn glyph by
+ * glyph right away. Right aligned and centered text has to know its width first, so
+ * the pen keeps the characters in a small array and adds up their widths as they
+ * arrive. That replaces the separate measure pass, and the glyphs are drawn once the
+ * text is complete. Numbers are converted least significant digit first into a few
+ * bytes on the stack, then fed to the pen in reading order.
+ */
+
+#include <stdarg.h>
+
+#include "ssd1306_internal.h"
+
+#define FORMAT_MAX_CHARS 64     // characters kept for right aligned and centered text
+#define FORMAT_MAX_DECIMALS 9   // fraction digits that fit an uint32_t
+
+typedef struct {
+  struct mgos_ssd1306 *oled;
+  int16_t x;
+  int16_t y;
+  mgos_ssd1306_color_t foreground;
+  mgos_ssd1306_color_t background;
+  bool direct;                  // left aligned: draw glyphs as they arrive
+  uint16_t width;               // width of the text so far
+  uint8_t count;                // characters so far
+  char chars[FORMAT_MAX_CHARS]; // characters kept while !direct
+} pen_t;
+
+typedef struct {
+  uint8_t width;                // minimum field width
+  uint8_t decimals;             // fraction digits
+  uint8_t base;
+  bool upper;                   // upper case hex digits
+  bool zero;                    // pad with zeros
+  bool left;                    // pad on the right
+} number_t;
+
+static void _pen_init (pen_t *pen, struct mgos_ssd1306 *oled, int16_t x, int16_t y, mgos_ssd1306_align_t align,
+                       mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background) {
+  pen->oled = oled;
+  pen->x = x;
+  pen->y = y;
+  pen->foreground = foreground;
+  pen->background = background;
+  pen->direct = (align == SSD1306_ALIGN_LEFT);
+  pen->width = 0;
+  pen->count = 0;
+}
+
+static void _put (pen_t *pen, char c) {
+  const font_info_t *font = pen->oled->font;
+
+  if (!pen->direct && pen->count >= FORMAT_MAX_CHARS)
+    return;
+  if (pen->count)
+    pen->width += font->c;
+  if (pen->direct)
+    pen->width += mgos_ssd1306_draw_char (pen->oled, pen->x + pen->width, pen->y, c, pen->foreground, pen->background);
+  else
+    pen->width += _glyph_width (font, c);
+  if (!pen->direct)
+    pen->chars[pen->count] = c;
+  if (pen->count < UINT8_MAX)
+    pen->count++;
+}
+
+static void _put_repeat (pen_t *pen, char c, int16_t n) {
+  while (n-- > 0)
+    _put (pen, c);
+}
+
+// Draw kept characters now that the width is known; returns the width
+static uint16_t _pen_flush (pen_t *pen, mgos_ssd1306_align_t align) {
+  const font_info_t *font = pen->oled->font;
+  int16_t x;
+
+  if (pen->direct)
+    return pen->width;
+  x = (align == SSD1306_ALIGN_RIGHT) ? pen->x - pen->width + 1 : pen->x - pen->width / 2;
+  for (uint8_t i = 0; i < pen->count; ++i)
+    x += mgos_ssd1306_draw_char (pen->oled, x, pen->y, pen->chars[i], pen->foreground, pen->background) + font->c;
+  return pen->width;
+}
+
+// Output integer part and fraction digits with sign and padding
+static void _put_number (pen_t *pen, uint32_t value, uint32_t fraction, bool negative, const number_t *spec) {
+  const char *digits = spec->upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  char rev[12 + FORMAT_MAX_DECIMALS];
+  uint8_t n = 0;
+  int16_t pad;
+
+  for (uint8_t i = 0; i < spec->decimals; ++i) {
+    rev[n++] = '0' + fraction % 10;
+    fraction /= 10;
+  }
+  if (spec->decimals)
+    rev[n++] = '.';
+  do {
+    rev[n++] = digits[value % spec->base];
+    value /= spec->base;
+  } while (value);
+
+  pad = (int16_t) spec->width - n - negative;
+  if (!spec->left && !spec->zero)
+    _put_repeat (pen, ' ', pad);
+  if (negative)
+    _put (pen, '-');
+  if (!spec->left && spec->zero)
+    _put_repeat (pen, '0', pad);
+  while (n)
+    _put (pen, rev[--n]);
+  if (spec->left)
+    _put_repeat (pen, ' ', pad);
+}
+
+static uint32_t _scale (uint8_t decimals) {
+  uint32_t scale = 1;
+
+  while (decimals--)
+    scale *= 10;
+  return scale;
+}
+
+// Split a fixed point value into integer part and fraction
+static void _put_fixed (pen_t *pen, int32_t value, number_t *spec) {
+  uint32_t v = (value < 0) ? -(uint32_t) value : (uint32_t) value;
+  uint32_t scale = _scale (spec->decimals);
+
+  _put_number (pen, v / scale, v % scale, value < 0, spec);
+}
+
+uint16_t mgos_ssd1306_draw_int (struct mgos_ssd1306 *oled, int16_t x, int16_t y, int32_t value, mgos_ssd1306_align_t align,
+                                mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background) {
+  return mgos_ssd1306_draw_fixed (oled, x, y, value, 0, align, foreground, background);
+}
+
+uint16_t mgos_ssd1306_draw_fixed (struct mgos_ssd1306 *oled, int16_t x, int16_t y, int32_t value, uint8_t decimals,
+                                  mgos_ssd1306_align_t align, mgos_ssd1306_color_t foreground,
+                                  mgos_ssd1306_color_t background) {
+  number_t spec = { .base = 10 };
+  pen_t pen;
+
+  if (oled == NULL || oled->font == NULL)
+    return 0;
+
+  spec.decimals = (decimals > FORMAT_MAX_DECIMALS) ? FORMAT_MAX_DECIMALS : decimals;
+  _pen_init (&pen, oled, x, y, align, foreground, background);
+  _put_fixed (&pen, value, &spec);
+  return _pen_flush (&pen, align);
+}
+
+uint16_t mgos_ssd1306_draw_printf (struct mgos_ssd1306 *oled, int16_t x, int16_t y, mgos_ssd1306_align_t align,
+                                   mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background, const char *fmt, ...) {
+  pen_t pen;
+  va_list ap;
+
+  if (oled == NULL || oled->font == NULL || fmt == NULL)
+    return 0;
+
+  _pen_init (&pen, oled, x, y, align, foreground, background);
+  va_start (ap, fmt);
+  while (*fmt) {
+    number_t spec = { .base = 10 };
+    int16_t precision = -1;
+    bool is_long = false;
+    const char *start = fmt;
+
+    if (*fmt != '%') {
+      _put (&pen, *fmt++);
+      continue;
+    }
+    fmt++;
+    for (;; fmt++) {
+      if (*fmt == '-')
+        spec.left = true;
+      else if (*fmt == '0')
+        spec.zero = true;
+      else
+        break;
+    }
+    while (*fmt >= '0' && *fmt <= '9') {
+      if (spec.width < FORMAT_MAX_CHARS)
+        spec.width = spec.width * 10 + (*fmt - '0');
+      fmt++;
+    }
+    if (*fmt == '.') {
+      precision = 0;
+      while (*++fmt >= '0' && *fmt <= '9') {
+        if (precision < FORMAT_MAX_CHARS)
+          precision = precision * 10 + (*fmt - '0');
+      }
+    }
+    if (*fmt == 'l') {
+      is_long = true;
+      fmt++;
+    }
+
+    switch (*fmt) {
+    case 'd':
+    case 'i': {
+      int32_t v = is_long ? (int32_t) va_arg (ap, long) : va_arg (ap, int);
+
+      _put_fixed (&pen, v, &spec);
+      break;
+    }
+    case 'u':
+    case 'x':
+    case 'X': {
+      uint32_t v = is_long ? (uint32_t) va_arg (ap, unsigned long) : va_arg (ap, unsigned int);
+
+      spec.base = (*fmt == 'u') ? 10 : 16;
+      spec.upper = (*fmt == 'X');
+      _put_number (&pen, v, 0, false, &spec);
+      break;
+    }
+    case 'f': {
+      double v = va_arg (ap, double);
+      double a = (v < 0) ? -v : v;
+      uint32_t scale, value, fraction;
+
+      spec.decimals = (precision < 0) ? 6 : (precision > FORMAT_MAX_DECIMALS) ? FORMAT_MAX_DECIMALS : precision;
+      scale = _scale (spec.decimals);
+      value = (a < 4294967295.0) ? (uint32_t) a : UINT32_MAX;
+      fraction = (uint32_t) ((a - value) * scale + 0.5);
+      if (fraction >= scale) {
+        fraction -= scale;
+        value++;
+      }
+      _put_number (&pen, value, fraction, v < 0 && (value || fraction), &spec);
+      break;
+    }
+    case 'c':
+      _put (&pen, (char) va_arg (ap, int));
+      break;
+    case 's': {
+      const char *s = va_arg (ap, const char *);
+      int16_t n = 0;
+
+      if (s == NULL)
+        s = "(null)";
+      while (s[n] && (precision < 0 || n < precision))
+        n++;
+      if (!spec.left)
+        _put_repeat (&pen, ' ', (int16_t) spec.width - n);
+      for (int16_t i = 0; i < n; ++i)
+        _put (&pen, s[i]);
+      if (spec.left)
+        _put_repeat (&pen, ' ', (int16_t) spec.width - n);
+      break;
+    }
+    case '%':
+      _put (&pen, '%');
+      break;
+    default:
+      // unsupported conversion: show it as is
+      while (start < fmt)
+        _put (&pen, *start++);
+      if (*fmt == '\0')
+        continue;
+      _put (&pen, *fmt);
+      break;
+    }
+    fmt++;
+  }
+  va_end (ap);
+  return _pen_flush (&pen, align);
+}
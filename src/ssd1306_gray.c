@@ -0,0 +1,288 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Temporal dither grayscale.
+ *
+ * A gray canvas holds 2 bits per pixel as two 1bpp planes in the canvas layout, LSB
+ * and MSB. The panel shows one plane per frame, and a fast frame rate mixes them
+ * into 4 levels. Without weighting the sequence is MSB, MSB, LSB. With contrast
+ * weighting it is MSB at full contrast, then LSB at half contrast (register 0x81).
+ * That gives the same 4 levels in 2 frames, so there is less flicker.
+ *
+ * Pixels with equal bits in both planes look the same in every frame, so only the
+ * "gray" columns, where the planes differ, are sent when the plane changes. They
+ * are kept per page. Drawing marks the driver's dirty window as usual. On the next
+ * frame that window is queued for both planes, so each plane receives every
+ * change once.
+ */
+
+#include "mgos_timers.h"
+
+#include "ssd1306_internal.h"
+
+#define GRAY_NO_PLANE 2
+#define GRAY_CONTRAST_MSB 0xff
+#define GRAY_CONTRAST_LSB 0x7f
+
+typedef struct {
+  int16_t left, top, right, bottom;     // empty when right < left
+} gray_rect_t;
+
+struct mgos_ssd1306_gray {
+  struct mgos_ssd1306 *oled;
+  bool weighted;                // contrast weighting, 2 frame cycle
+  uint8_t contrast;             // contrast before the gray canvas, put back when freed
+  uint8_t phase;                // position in the frame cycle
+  uint8_t shown;                // plane on the panel, GRAY_NO_PLANE before the first frame
+  mgos_timer_id timer;
+  gray_rect_t pending[2];       // changes not yet sent, per plane
+  uint32_t frames;              // statistics
+  uint32_t bytes;
+  uint32_t busy_us;
+  uint8_t *span_left;           // per page: columns where the planes differ
+  uint8_t *span_right;
+  uint8_t *planes;              // LSB plane, followed by the MSB plane
+};
+
+static inline uint32_t _plane_size (const struct mgos_ssd1306 *oled) {
+  return (uint32_t) oled->canvas_width * oled->canvas_height / 8;
+}
+
+static void _rect_add (gray_rect_t *r, int16_t left, int16_t top, int16_t right, int16_t bottom) {
+  if (r->right < r->left || r->bottom < r->top) {
+    r->left = left;
+    r->top = top;
+    r->right = right;
+    r->bottom = bottom;
+    return;
+  }
+  if (r->left > left)
+    r->left = left;
+  if (r->top > top)
+    r->top = top;
+  if (r->right < right)
+    r->right = right;
+  if (r->bottom < bottom)
+    r->bottom = bottom;
+}
+
+// Find the columns of each page where the planes differ
+static void _update_spans (struct mgos_ssd1306_gray *gray) {
+  struct mgos_ssd1306 *oled = gray->oled;
+  const uint8_t *lsb = gray->planes, *msb = gray->planes + _plane_size (oled);
+
+  for (uint16_t page = 0; page < oled->canvas_height / 8; ++page) {
+    uint16_t offset = page * oled->canvas_width, left, right;
+
+    if (ssd1306_diff_bytes (lsb + offset, msb + offset, oled->canvas_width, &left, &right)) {
+      gray->span_left[page] = left;
+      gray->span_right[page] = right;
+    } else {
+      gray->span_left[page] = 1;
+      gray->span_right[page] = 0;
+    }
+  }
+}
+
+static void _frame_cb (void *arg) {
+  mgos_ssd1306_gray_frame ((struct mgos_ssd1306_gray *) arg);
+}
+
+struct mgos_ssd1306_gray *mgos_ssd1306_gray_create (struct mgos_ssd1306 *oled, bool weighted) {
+  struct mgos_ssd1306_gray *gray;
+  uint16_t pages;
+
+  if (oled == NULL)
+    return NULL;
+  if (oled->gray != NULL || oled->frame != NULL || oled->layers != NULL || oled->rotation || oled->canvas_width != oled->width ||
+      oled->canvas_height != oled->height) {
+    LOG (LL_ERROR, ("Grayscale needs a panel-sized frame buffer without layers"));
+    return NULL;
+  }
+
+  pages = oled->canvas_height / 8;
+  // the planes start on a word boundary, like the canvas
+  gray = calloc (1, SSD1306_ALIGN (sizeof (*gray) + 2 * pages) + 2 * _plane_size (oled));
+  if (gray == NULL) {
+    LOG (LL_ERROR, ("Out of memory creating gray canvas"));
+    return NULL;
+  }
+  gray->oled = oled;
+  gray->weighted = weighted;
+  gray->contrast = oled->contrast;
+  gray->shown = GRAY_NO_PLANE;
+  gray->timer = MGOS_INVALID_TIMER_ID;
+  // the panel still shows the 1bpp canvas, both planes replace all of it
+  for (uint8_t i = 0; i < 2; ++i)
+    _rect_add (&gray->pending[i], 0, 0, oled->width - 1, oled->height - 1);
+  gray->span_left = (uint8_t *) (gray + 1);
+  gray->span_right = gray->span_left + pages;
+  gray->planes = (uint8_t *) gray + SSD1306_ALIGN (sizeof (*gray) + 2 * pages);
+  _update_spans (gray);
+  oled->gray = gray;
+  return gray;
+}
+
+void mgos_ssd1306_gray_free (struct mgos_ssd1306_gray *gray) {
+  struct mgos_ssd1306 *oled;
+
+  if (gray == NULL)
+    return;
+
+  oled = gray->oled;
+  mgos_ssd1306_gray_stop (gray);
+  if (gray->weighted && gray->shown != GRAY_NO_PLANE) {
+    mgos_ssd1306_command (oled, 0x81);  // SSD1306_SETCONTRAST
+    mgos_ssd1306_command (oled, gray->contrast);
+  }
+  if (oled->buffer >= gray->planes && oled->buffer < gray->planes + 2 * _plane_size (oled))
+    oled->buffer = _canvas (oled);
+  oled->gray = NULL;
+  free (gray);
+  // the next refresh puts the 1bpp canvas back
+  _mark_dirty (oled, 0, 0, oled->canvas_width - 1, oled->canvas_height - 1);
+}
+
+void mgos_ssd1306_gray_select_plane (struct mgos_ssd1306_gray *gray, uint8_t plane) {
+  if (gray == NULL || plane > 1)
+    return;
+
+  gray->oled->buffer = gray->planes + plane * _plane_size (gray->oled);
+}
+
+void mgos_ssd1306_gray_pixel (struct mgos_ssd1306_gray *gray, int16_t x, int16_t y, uint8_t level) {
+  mgos_ssd1306_gray_fill_rectangle (gray, x, y, 1, 1, level);
+}
+
+void mgos_ssd1306_gray_fill_rectangle (struct mgos_ssd1306_gray *gray, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                       uint8_t level) {
+  struct mgos_ssd1306 *oled;
+  struct mgos_ssd1306_dlist *dlist;
+  uint8_t *buffer;
+
+  if (gray == NULL)
+    return;
+
+  // planes are drawn directly, also while a display list is recorded
+  oled = gray->oled;
+  buffer = oled->buffer;
+  dlist = oled->dlist;
+  oled->dlist = NULL;
+  for (uint8_t plane = 0; plane < 2; ++plane) {
+    oled->buffer = gray->planes + plane * _plane_size (oled);
+    mgos_ssd1306_fill_rectangle (oled, x, y, w, h, (level >> plane) & 1 ? SSD1306_COLOR_WHITE : SSD1306_COLOR_BLACK);
+  }
+  oled->buffer = buffer;
+  oled->dlist = dlist;
+}
+
+void mgos_ssd1306_gray_frame (struct mgos_ssd1306_gray *gray) {
+  struct mgos_ssd1306 *oled;
+  int64_t start = mgos_uptime_micros ();
+  const uint8_t *data;
+  gray_rect_t *pending;
+  uint8_t plane;
+
+  if (gray == NULL)
+    return;
+
+  oled = gray->oled;
+  if (oled->refresh_right >= oled->refresh_left) {
+    // changes since the last frame go to both planes
+    for (uint8_t i = 0; i < 2; ++i)
+      _rect_add (&gray->pending[i], oled->refresh_left, oled->refresh_top, oled->refresh_right, oled->refresh_bottom);
+    _reset_dirty (oled);
+    _update_spans (gray);
+  }
+
+  if (gray->weighted) {
+    gray->phase = (gray->phase + 1) % 2;
+    plane = gray->phase ? 0 : 1;
+  } else {
+    gray->phase = (gray->phase + 1) % 3;
+    plane = (gray->phase == 2) ? 0 : 1;
+  }
+  data = gray->planes + plane * _plane_size (oled);
+  pending = &gray->pending[plane];
+
+  for (uint16_t page = 0; page < oled->height / 8; ++page) {
+    int16_t left = 1, right = 0;
+
+    if (pending->right >= pending->left && page * 8 + 7 >= pending->top && page * 8 <= pending->bottom) {
+      left = pending->left;
+      right = pending->right;
+    }
+    if (plane != gray->shown && gray->span_left[page] <= gray->span_right[page]) {
+      if (left > right || left > gray->span_left[page])
+        left = gray->span_left[page];
+      if (right < gray->span_right[page])
+        right = gray->span_right[page];
+    }
+    if (left <= right) {
+      ssd1306_write_page (oled, page, left, right - left + 1, data + page * oled->canvas_width + left);
+      gray->bytes += right - left + 1;
+    }
+  }
+  pending->right = pending->left - 1;
+
+  // the contrast follows the plane; switching it after the data keeps the
+  // mismatch to the time the controller takes to latch one command
+  if (gray->weighted && plane != gray->shown) {
+    mgos_ssd1306_command (oled, 0x81);  // SSD1306_SETCONTRAST
+    mgos_ssd1306_command (oled, plane ? GRAY_CONTRAST_MSB : GRAY_CONTRAST_LSB);
+  }
+  gray->shown = plane;
+  gray->frames++;
+  gray->busy_us += (uint32_t) (mgos_uptime_micros () - start);
+}
+
+bool mgos_ssd1306_gray_start (struct mgos_ssd1306_gray *gray, uint16_t rate) {
+  if (gray == NULL || rate == 0)
+    return false;
+
+  mgos_ssd1306_gray_stop (gray);
+  gray->timer = mgos_set_timer ((rate >= 1000) ? 1 : 1000 / rate, MGOS_TIMER_REPEAT, _frame_cb, gray);
+  return gray->timer != MGOS_INVALID_TIMER_ID;
+}
+
+void mgos_ssd1306_gray_stop (struct mgos_ssd1306_gray *gray) {
+  if (gray == NULL || gray->timer == MGOS_INVALID_TIMER_ID)
+    return;
+
+  mgos_clear_timer (gray->timer);
+  gray->timer = MGOS_INVALID_TIMER_ID;
+}
+
+void mgos_ssd1306_gray_get_stats (struct mgos_ssd1306_gray *gray, uint32_t *frames, uint32_t *bytes, uint32_t *busy_us) {
+  if (gray == NULL)
+    return;
+
+  if (frames != NULL)
+    *frames = gray->frames;
+  if (bytes != NULL)
+    *bytes = gray->bytes;
+  if (busy_us != NULL)
+    *busy_us = gray->busy_us;
+}
@@ -20,29 +20,7 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *
  **/
-#include "ssd1306.h"
-
-#ifdef __GNUC__
-#define UNUSED(x) x __attribute__((unused))
-#else
-#define UNUSED(x) x
-#endif
-
-typedef struct mgos_ssd1306 {
-  uint8_t address;              // I2C address
-  uint8_t width;                // panel width
-  uint8_t height;               // panel height
-  uint8_t col_offset;           // some displays have panel's starting column
-                                // connected to seg pin other than 0.
-  uint8_t com_pins;             // COM pins configuration
-  uint8_t refresh_top;          // 'Dirty' window corners
-  uint8_t refresh_left;
-  uint8_t refresh_right;
-  uint8_t refresh_bottom;
-  const font_info_t *font;      // current font
-  struct mgos_i2c *i2c;         // i2c connection
-  uint8_t buffer[0];            // display buffer (continues beyond the struct)
-} mgos_ssd1306;
+#include "ssd1306_internal.h"
 
 static struct mgos_ssd1306 *s_global_ssd1306;
 
@@ -50,9 +28,54 @@ static inline bool _command (struct mgos_ssd1306 *oled, uint8_t cmd) {
   return mgos_i2c_write_reg_b (oled->i2c, oled->address, 0x80, cmd);
 }
 
+// Send part of a panel page; the viewport may start in the middle of a canvas page,
+// in which case the panel page is stitched from two canvas pages.
+static void _send_page (struct mgos_ssd1306 *oled, uint8_t page, uint8_t col, uint8_t len) {
+  uint8_t shift = oled->view_y & 7;
+  const uint8_t *src = oled->buffer + (oled->view_y / 8 + page) * oled->canvas_width + oled->view_x + col;
+
+  if (shift) {
+    const uint8_t *next = src + oled->canvas_width;
+    for (uint8_t i = 0; i < len; ++i)
+      oled->line[i] = (src[i] >> shift) | (next[i] << (8 - shift));
+    src = oled->line;
+  }
+  mgos_i2c_write_reg_n (oled->i2c, oled->address, 0x40, len, src);
+}
+
+void ssd1306_write_page (struct mgos_ssd1306 *oled, uint8_t page, uint8_t col, uint8_t len, const uint8_t *data) {
+  _command (oled, 0x21);        // SSD1306_COLUMNADDR
+  _command (oled, oled->col_offset + col);
+  _command (oled, oled->col_offset + col + len - 1);
+  _command (oled, 0x22);        // SSD1306_PAGEADDR
+  _command (oled, page);
+  _command (oled, page);
+  mgos_i2c_write_reg_n (oled->i2c, oled->address, 0x40, len, data);
+}
+
 struct mgos_ssd1306 *mgos_ssd1306_create (const struct mgos_config_ssd1306 *cfg) {
   struct mgos_ssd1306 *oled = NULL;
-  oled = calloc (1, sizeof (*oled) + cfg->width * cfg->height / 8);
+  uint16_t canvas_width = (cfg->canvas_width > cfg->width) ? cfg->canvas_width : cfg->width;
+  uint16_t canvas_height = (cfg->canvas_height > cfg->height) ? cfg->canvas_height : cfg->height;
+  uint32_t canvas_size;
+  uint16_t line_size;
+
+  if (!cfg->framebuffer) {
+    // pages are rendered one at a time into the scratch page, the canvas is the panel
+    canvas_width = cfg->width;
+    canvas_height = cfg->height;
+  }
+  canvas_height = (canvas_height + 7) & ~7;
+  canvas_size = cfg->framebuffer ? (uint32_t) canvas_width * canvas_height / 8 : 0;
+  if (canvas_size > UINT16_MAX) {
+    LOG (LL_ERROR, ("SSD1306 canvas %dx%d is too large", canvas_width, canvas_height));
+    return NULL;
+  }
+
+  // the scratch page is needed to view a tall canvas from any row and for portrait
+  // mode, which may be selected at any time
+  line_size = cfg->width;
+  oled = calloc (1, SSD1306_ALIGN (sizeof (*oled)) + canvas_size + line_size);
   if (oled == NULL)
     return NULL;
 
@@ -61,6 +84,18 @@ struct mgos_ssd1306 *mgos_ssd1306_create (const struct mgos_config_ssd1306 *cfg)
   oled->height = cfg->height;
   oled->col_offset = cfg->col_offset;
   oled->com_pins = cfg->com_pins;
+  oled->canvas_width = canvas_width;
+  oled->canvas_height = canvas_height;
+  if (canvas_size)
+    oled->buffer = _canvas (oled);
+  oled->line = _canvas (oled) + canvas_size;
+  if (!cfg->framebuffer) {
+    oled->frame = mgos_ssd1306_dlist_create ();
+    if (oled->frame == NULL)
+      goto out_err;
+    oled->dlist = oled->frame;
+  }
+  _reset_clip (oled);
   if (cfg->i2c.enable && cfg->i2c.scl_gpio != -1 && cfg->i2c.sda_gpio != -1) {
     LOG (LL_INFO, ("Using SSD1306 GPIO config"));
     const struct mgos_config_i2c i2c_cfg = {
@@ -97,6 +132,7 @@ struct mgos_ssd1306 *mgos_ssd1306_create (const struct mgos_config_ssd1306 *cfg)
   _command (oled, oled->com_pins);
   _command (oled, 0x81);        // SSD1306_SETCONTRAST
   _command (oled, 0x7f);        // default contrast ratio
+  oled->contrast = 0x7f;
   _command (oled, 0xa4);        // SSD1306_DISPLAYALLON_RESUME
   _command (oled, 0xa6);        // SSD1306_NORMALDISPLAY
   _command (oled, 0xd5);        // SSD1306_SETDISPLAYCLOCKDIV
@@ -114,16 +150,20 @@ struct mgos_ssd1306 *mgos_ssd1306_create (const struct mgos_config_ssd1306 *cfg)
   mgos_ssd1306_clear (oled);
   mgos_ssd1306_refresh (oled, true);
   mgos_ssd1306_select_font (oled, 0);
+  if (cfg->rotation != 0)
+    mgos_ssd1306_set_rotation (oled, cfg->rotation);
 
   LOG (LL_DEBUG, ("Turning on display"));
   _command (oled, 0x2e);        // SSD1306_SCROLLSTOP
   _command (oled, 0xaf);        // SSD1306_DISPLAYON
 
-  LOG (LL_INFO, ("SSD1306 init ok (width: %d, height: %d, address: 0x%02x)", oled->width, oled->height, oled->address));
+  LOG (LL_INFO, ("SSD1306 init ok (width: %d, height: %d, canvas: %dx%d%s, address: 0x%02x)", oled->width, oled->height,
+                 oled->canvas_width, oled->canvas_height, oled->frame ? " paged" : "", oled->address));
   return oled;
 
 out_err:
   LOG (LL_ERROR, ("SSD1306 setup failed"));
+  mgos_ssd1306_dlist_free (oled->frame);
   free (oled);
   return NULL;
 }
@@ -132,6 +172,8 @@ void mgos_ssd1306_close (struct mgos_ssd1306 *oled) {
   if (oled == NULL)
     return;
 
+  mgos_ssd1306_select_canvas (oled, NULL);
+  mgos_ssd1306_gray_free (oled->gray);
   _command (oled, 0xae);        // SSD_DISPLAYOFF
   _command (oled, 0x8d);        // SSD1306_CHARGEPUMP
   _command (oled, 0x10);        // Charge pump off
@@ -139,9 +181,12 @@ void mgos_ssd1306_close (struct mgos_ssd1306 *oled) {
   if (oled->i2c)
     mgos_i2c_close (oled->i2c);
 
-  if (oled->buffer)
-    free (oled->buffer);
-
+  // the canvas buffer is part of the driver allocation
+  ssd1306_widgets_free (oled);
+  ssd1306_screens_free (oled);
+  ssd1306_layers_free (oled);
+  mgos_ssd1306_dlist_free (oled->frame);
+  free (oled->saved);
   free (oled);
 }
 
@@ -149,162 +194,252 @@ uint8_t mgos_ssd1306_get_width (struct mgos_ssd1306 *oled) {
   if (oled == NULL)
     return 0;
 
-  return oled->width;
+  return oled->rotation ? oled->height : oled->width;
 }
 
 uint8_t mgos_ssd1306_get_height (struct mgos_ssd1306 * oled) {
   if (oled == NULL)
     return 0;
 
-  return oled->height;
+  return oled->rotation ? oled->width : oled->height;
+}
+
+uint16_t mgos_ssd1306_get_canvas_width (struct mgos_ssd1306 *oled) {
+  if (oled == NULL)
+    return 0;
+
+  return oled->canvas_width;
+}
+
+uint16_t mgos_ssd1306_get_canvas_height (struct mgos_ssd1306 *oled) {
+  if (oled == NULL)
+    return 0;
+
+  return oled->canvas_height;
+}
+
+void mgos_ssd1306_set_viewport (struct mgos_ssd1306 *oled, int16_t x, int16_t y) {
+  // the portrait canvas is the size of the panel
+  if (oled == NULL || oled->rotation)
+    return;
+
+  if (x > oled->canvas_width - oled->width)
+    x = oled->canvas_width - oled->width;
+  if (x < 0)
+    x = 0;
+  if (y > oled->canvas_height - oled->height)
+    y = oled->canvas_height - oled->height;
+  if (y < 0)
+    y = 0;
+  if (x == oled->view_x && y == oled->view_y)
+    return;
+
+  oled->view_x = x;
+  oled->view_y = y;
+  // everything on the panel moves, so the whole window must be resent
+  _mark_dirty (oled, x, y, x + oled->width - 1, y + oled->height - 1);
+}
+
+int16_t mgos_ssd1306_get_viewport_x (struct mgos_ssd1306 *oled) {
+  if (oled == NULL)
+    return 0;
+
+  return oled->view_x;
+}
+
+int16_t mgos_ssd1306_get_viewport_y (struct mgos_ssd1306 *oled) {
+  if (oled == NULL)
+    return 0;
+
+  return oled->view_y;
+}
+
+// Display lists replay drawing with the clip rectangle it was recorded with
+static void _record_clip (struct mgos_ssd1306 *oled) {
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { oled->clip_left, oled->clip_top, oled->clip_right, oled->clip_bottom };
+    ssd1306_dl_record (oled, SSD1306_DL_CLIP, args, NULL, 0);
+  }
+}
+
+void mgos_ssd1306_set_clip (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h) {
+  int32_t right, bottom;
+
+  if (oled == NULL)
+    return;
+
+  right = (int32_t) x + w - 1;
+  bottom = (int32_t) y + h - 1;
+  oled->clip_left = (x < 0) ? 0 : x;
+  oled->clip_top = (y < 0) ? 0 : y;
+  oled->clip_right = (right >= oled->canvas_width) ? oled->canvas_width - 1 : right;
+  oled->clip_bottom = (bottom >= oled->canvas_height) ? oled->canvas_height - 1 : bottom;
+  // an empty clip rectangle stays empty: right < left drops everything
+  if (oled->clip_right < oled->clip_left - 1)
+    oled->clip_right = oled->clip_left - 1;
+  if (oled->clip_bottom < oled->clip_top - 1)
+    oled->clip_bottom = oled->clip_top - 1;
+  _record_clip (oled);
+}
+
+void mgos_ssd1306_reset_clip (struct mgos_ssd1306 *oled) {
+  if (oled == NULL)
+    return;
+
+  _reset_clip (oled);
+  _record_clip (oled);
 }
 
 void mgos_ssd1306_clear (struct mgos_ssd1306 *oled) {
   if (oled == NULL)
     return;
+  // a display list always covers the whole canvas
+  if (oled->dlist != NULL) {
+    if (oled->dlist == oled->frame)
+      ssd1306_dl_clear (oled);
+    return;
+  }
 
-  memset (oled->buffer, 0, (oled->width * oled->height / 8));
-  oled->refresh_right = oled->width - 1;
-  oled->refresh_bottom = oled->height - 1;
-  oled->refresh_top = 0;
-  oled->refresh_left = 0;
+  ssd1306_fill_bytes (oled->buffer, oled->canvas_width * oled->canvas_height / 8, 0xff, SSD1306_COLOR_BLACK);
+  _mark_dirty (oled, 0, 0, oled->canvas_width - 1, oled->canvas_height - 1);
 }
 
 void mgos_ssd1306_refresh (struct mgos_ssd1306 *oled, bool force) {
+  int16_t top, left, right, bottom;
   uint8_t page_start, page_end;
 
   if (oled == NULL)
     return;
+  if (oled->target != NULL) {
+    LOG (LL_ERROR, ("SSD1306 refresh with an offscreen canvas selected"));
+    return;
+  }
+
+  if (oled->frame != NULL) {
+    ssd1306_dl_refresh (oled, force);
+    return;
+  }
+  // the gray canvas sends its own frames and takes the dirty window with it
+  if (oled->gray != NULL)
+    return;
+  if (oled->rotation) {
+    ssd1306_rotate_refresh (oled, force);
+    _reset_dirty (oled);
+    return;
+  }
 
-  if (force || (oled->refresh_top <= 0 && oled->refresh_bottom >= oled->height - 1 && oled->refresh_left <= 0 && oled->refresh_right >= oled->width - 1)) {
-    _command (oled, 0x21);                                // SSD1306_COLUMNADDR
-    _command (oled, oled->col_offset);                    // column start
-    _command (oled, oled->col_offset + oled->width - 1);  // column end
-    _command (oled, 0x22);                      // SSD1306_PAGEADDR
-    _command (oled, 0);                         // page start
-    _command (oled, (oled->height / 8) - 1);    // page end
-    mgos_i2c_write_reg_n (oled->i2c, oled->address, 0x40, oled->height * oled->width / 8, oled->buffer);
-  } else if ((oled->refresh_top <= oled->refresh_bottom)
-             && (oled->refresh_left <= oled->refresh_right)) {
-    page_start = oled->refresh_top / 8;
-    page_end = oled->refresh_bottom / 8;
-    _command (oled, 0x21);                                    // SSD1306_COLUMNADDR
-    _command (oled, oled->col_offset + oled->refresh_left);   // column start
-    _command (oled, oled->col_offset + oled->refresh_right);  // column end
+  // only the part of the dirty window inside the viewport is sent, in panel coordinates
+  top = force ? 0 : oled->refresh_top - oled->view_y;
+  left = force ? 0 : oled->refresh_left - oled->view_x;
+  right = force ? oled->width - 1 : oled->refresh_right - oled->view_x;
+  bottom = force ? oled->height - 1 : oled->refresh_bottom - oled->view_y;
+  if (top < 0)
+    top = 0;
+  if (left < 0)
+    left = 0;
+  if (right > oled->width - 1)
+    right = oled->width - 1;
+  if (bottom > oled->height - 1)
+    bottom = oled->height - 1;
+
+  if ((top <= bottom) && (left <= right)) {
+    uint8_t *buffer = oled->buffer;
+
+    page_start = top / 8;
+    page_end = bottom / 8;
+    if (oled->layers != NULL) {
+      // send the layers composited over the canvas pages behind the panel pages
+      ssd1306_layers_composite (oled, oled->view_x + left, (oled->view_y + page_start * 8) / 8, oled->view_x + right,
+                                (oled->view_y + page_end * 8 + 7) / 8);
+      oled->buffer = oled->composite;
+    }
+    _command (oled, 0x21);                            // SSD1306_COLUMNADDR
+    _command (oled, oled->col_offset + left);         // column start
+    _command (oled, oled->col_offset + right);        // column end
     _command (oled, 0x22);        // SSD1306_PAGEADDR
     _command (oled, page_start);  // page start
     _command (oled, page_end);    // page end
 
-    for (uint8_t i = page_start; i <= page_end; ++i) {
-      uint16_t start = i * oled->width + oled->refresh_left;
-      uint16_t len = oled->refresh_right - oled->refresh_left + 1;
+    if (left == 0 && right == oled->width - 1 && oled->canvas_width == oled->width && (oled->view_y & 7) == 0) {
+      // full-width window over a panel-sized canvas is contiguous in the buffer
+      uint16_t start = (oled->view_y / 8 + page_start) * oled->width;
+      uint16_t len = (page_end - page_start + 1) * oled->width;
       mgos_i2c_write_reg_n (oled->i2c, oled->address, 0x40, len, oled->buffer + start);
+    } else {
+      for (uint8_t i = page_start; i <= page_end; ++i)
+        _send_page (oled, i, left, right - left + 1);
     }
+    oled->buffer = buffer;
   }
   // reset dirty area
-  oled->refresh_top = 255;
-  oled->refresh_left = 255;
-  oled->refresh_right = 0;
-  oled->refresh_bottom = 0;
+  _reset_dirty (oled);
 }
 
-void mgos_ssd1306_draw_pixel (struct mgos_ssd1306 *oled, int8_t x, int8_t y, mgos_ssd1306_color_t color) {
-  uint16_t UNUSED (index) = x + (y / 8) * oled->width;
+void mgos_ssd1306_draw_pixel (struct mgos_ssd1306 *oled, int16_t x, int16_t y, mgos_ssd1306_color_t color) {
   if (oled == NULL)
     return;
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x, y, color };
+    ssd1306_dl_record (oled, SSD1306_DL_PIXEL, args, NULL, 0);
+    return;
+  }
 
-  if ((x >= oled->width) || (x < 0) || (y >= oled->height) || (y < 0))
+  if (!_in_clip (oled, x, y))
     return;
 
-  switch (color) {
-  case SSD1306_COLOR_WHITE:
-    oled->buffer[index] |= (1 << (y & 7));
-    break;
-  case SSD1306_COLOR_BLACK:
-    oled->buffer[index] &= ~(1 << (y & 7));
-    break;
-  case SSD1306_COLOR_INVERT:
-    oled->buffer[index] ^= (1 << (y & 7));
-    break;
-  default:
-    break;
-  }
-  if (oled->refresh_left > x)
-    oled->refresh_left = x;
-  if (oled->refresh_right < x)
-    oled->refresh_right = x;
-  if (oled->refresh_top > y)
-    oled->refresh_top = y;
-  if (oled->refresh_bottom < y)
-    oled->refresh_bottom = y;
+  _pixel (oled, x, y, color);
+  _mark_dirty (oled, x, y, x, y);
 }
 
-void mgos_ssd1306_draw_hline (struct mgos_ssd1306 *oled, int8_t x, int8_t y, uint8_t w, mgos_ssd1306_color_t color) {
-  uint16_t UNUSED (index);
-  uint8_t mask, t;
+void mgos_ssd1306_draw_pixels (struct mgos_ssd1306 *oled, const mgos_ssd1306_point_t *points, uint16_t count,
+                               mgos_ssd1306_color_t color) {
+  int16_t left = INT16_MAX, top = INT16_MAX, right = -1, bottom = -1;
 
-  if (oled == NULL)
+  if (oled == NULL || points == NULL)
     return;
-  // boundary check
-  if ((x >= oled->width) || (x < 0) || (y >= oled->height) || (y < 0))
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { color };
+    ssd1306_dl_record (oled, SSD1306_DL_PIXELS, args, points, count * sizeof (*points));
     return;
-  if (w == 0)
-    return;
-  if (x + w > oled->width)
-    w = oled->width - x;
+  }
 
-  t = w;
-  index = x + (y / 8) * oled->width;
-  mask = 1 << (y & 7);
-  switch (color) {
-  case SSD1306_COLOR_WHITE:
-    while (t--) {
-      oled->buffer[index] |= mask;
-      ++index;
-    }
-    break;
-  case SSD1306_COLOR_BLACK:
-    mask = ~mask;
-    while (t--) {
-      oled->buffer[index] &= mask;
-      ++index;
-    }
-    break;
-  case SSD1306_COLOR_INVERT:
-    while (t--) {
-      oled->buffer[index] ^= mask;
-      ++index;
-    }
-    break;
-  default:
-    break;
+  for (uint16_t i = 0; i < count; ++i) {
+    mgos_ssd1306_point_t p;
+    int16_t x, y;
+
+    // points may come unaligned from the mJS FFI
+    memcpy (&p, &points[i], sizeof (p));
+    x = p.x;
+    y = p.y;
+    if (!_in_clip (oled, x, y))
+      continue;
+    _pixel (oled, x, y, color);
+    if (left > x)
+      left = x;
+    if (right < x)
+      right = x;
+    if (top > y)
+      top = y;
+    if (bottom < y)
+      bottom = y;
   }
-  if (oled->refresh_left > x)
-    oled->refresh_left = x;
-  if (oled->refresh_right < x + w - 1)
-    oled->refresh_right = x + w - 1;
-  if (oled->refresh_top > y)
-    oled->refresh_top = y;
-  if (oled->refresh_bottom < y)
-    oled->refresh_bottom = y;
+  if (right >= 0)
+    _mark_dirty (oled, left, top, right, bottom);
 }
 
-void mgos_ssd1306_draw_vline (struct mgos_ssd1306 *oled, int8_t x, int8_t y, uint8_t h, mgos_ssd1306_color_t color) {
-  uint16_t UNUSED (index);
-  uint8_t mask, mod, t;
+// Unchecked horizontal span; the caller clips and marks the dirty region.
+void ssd1306_hline (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, mgos_ssd1306_color_t color) {
+  ssd1306_fill_bytes (oled->buffer + x + (y / 8) * oled->canvas_width, w, 1 << (y & 7), color);
+}
 
-  if (oled == NULL)
-    return;
-  // boundary check
-  if ((x >= oled->width) || (x < 0) || (y >= oled->height) || (y < 0))
-    return;
-  if (h == 0)
-    return;
-  if (y + h > oled->height)
-    h = oled->height - y;
+// Unchecked vertical span; the caller clips and marks the dirty region.
+void ssd1306_vline (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t h, mgos_ssd1306_color_t color) {
+  uint16_t index;
+  uint16_t t;
+  uint8_t mask, mod;
 
   t = h;
-  index = x + (y / 8) * oled->width;
+  index = x + (y / 8) * oled->canvas_width;
   mod = y & 7;
   if (mod)                      // partial line that does not fit into byte at top
   {
@@ -328,9 +463,9 @@ void mgos_ssd1306_draw_vline (struct mgos_ssd1306 *oled, int8_t x, int8_t y, uin
       break;
     }
     if (t < mod)
-      goto draw_vline_finish;
+      return;
     t -= mod;
-    index += oled->width;
+    index += oled->canvas_width;
   }
   if (t >= 8)                   // byte aligned line at middle
   {
@@ -338,7 +473,7 @@ void mgos_ssd1306_draw_vline (struct mgos_ssd1306 *oled, int8_t x, int8_t y, uin
     case SSD1306_COLOR_WHITE:
       do {
         oled->buffer[index] = 0xff;
-        index += oled->width;
+        index += oled->canvas_width;
         t -= 8;
       }
       while (t >= 8);
@@ -346,7 +481,7 @@ void mgos_ssd1306_draw_vline (struct mgos_ssd1306 *oled, int8_t x, int8_t y, uin
     case SSD1306_COLOR_BLACK:
       do {
         oled->buffer[index] = 0x00;
-        index += oled->width;
+        index += oled->canvas_width;
         t -= 8;
       }
       while (t >= 8);
@@ -354,7 +489,7 @@ void mgos_ssd1306_draw_vline (struct mgos_ssd1306 *oled, int8_t x, int8_t y, uin
     case SSD1306_COLOR_INVERT:
       do {
         oled->buffer[index] = ~oled->buffer[index];
-        index += oled->width;
+        index += oled->canvas_width;
         t -= 8;
       }
       while (t >= 8);
@@ -382,126 +517,308 @@ void mgos_ssd1306_draw_vline (struct mgos_ssd1306 *oled, int8_t x, int8_t y, uin
       break;
     }
   }
-draw_vline_finish:
-  if (oled->refresh_left > x)
-    oled->refresh_left = x;
-  if (oled->refresh_right < x)
-    oled->refresh_right = x;
-  if (oled->refresh_top > y)
-    oled->refresh_top = y;
-  if (oled->refresh_bottom < y + h - 1)
-    oled->refresh_bottom = y + h - 1;
-  return;
 }
 
-void mgos_ssd1306_draw_rectangle (struct mgos_ssd1306 *oled, int8_t x, int8_t y, uint8_t w, uint8_t h, mgos_ssd1306_color_t color) {
-  mgos_ssd1306_draw_hline (oled, x, y, w, color);
-  mgos_ssd1306_draw_hline (oled, x, y + h - 1, w, color);
-  mgos_ssd1306_draw_vline (oled, x, y, h, color);
-  mgos_ssd1306_draw_vline (oled, x + w - 1, y, h, color);
+void mgos_ssd1306_draw_hline (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, mgos_ssd1306_color_t color) {
+  if (oled == NULL)
+    return;
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x, y, w, color };
+    ssd1306_dl_record (oled, SSD1306_DL_HLINE, args, NULL, 0);
+    return;
+  }
+  // boundary check
+  if ((x > oled->clip_right) || (y > oled->clip_bottom) || (y < oled->clip_top))
+    return;
+  if (x < oled->clip_left) {
+    if (w <= oled->clip_left - x)
+      return;
+    w -= oled->clip_left - x;
+    x = oled->clip_left;
+  }
+  if (x + w > oled->clip_right + 1)
+    w = oled->clip_right + 1 - x;
+  if (w == 0)
+    return;
+
+  ssd1306_hline (oled, x, y, w, color);
+  _mark_dirty (oled, x, y, x + w - 1, y);
 }
 
-void mgos_ssd1306_fill_rectangle (struct mgos_ssd1306 *oled, int8_t x, int8_t y, uint8_t w, uint8_t h, mgos_ssd1306_color_t color) {
-  // Can be optimized?
-  uint8_t i;
-  for (i = x; i < x + w; ++i)
-    mgos_ssd1306_draw_vline (oled, i, y, h, color);
+void mgos_ssd1306_draw_vline (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t h, mgos_ssd1306_color_t color) {
+  if (oled == NULL)
+    return;
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x, y, h, color };
+    ssd1306_dl_record (oled, SSD1306_DL_VLINE, args, NULL, 0);
+    return;
+  }
+  // boundary check
+  if ((x > oled->clip_right) || (x < oled->clip_left) || (y > oled->clip_bottom))
+    return;
+  if (y < oled->clip_top) {
+    if (h <= oled->clip_top - y)
+      return;
+    h -= oled->clip_top - y;
+    y = oled->clip_top;
+  }
+  if (y + h > oled->clip_bottom + 1)
+    h = oled->clip_bottom + 1 - y;
+  if (h == 0)
+    return;
+
+  ssd1306_vline (oled, x, y, h, color);
+  _mark_dirty (oled, x, y, x, y + h - 1);
 }
 
-void mgos_ssd1306_draw_circle (struct mgos_ssd1306 *oled, int8_t x0, int8_t y0, uint8_t r, mgos_ssd1306_color_t color) {
-  // Refer to http://en.wikipedia.org/wiki/Midpoint_circle_algorithm for the algorithm
+// Narrow the step range [*lo, *hi] of a Bresenham walk to the steps whose minor
+// axis offset is within [min, max]. After k steps along a major axis of length n,
+// the walk below has moved (k * d + c) / n along the minor axis of length d, with
+// c = n - 1 - n / 2 from the initial error term.
+static void _minor_range (int32_t n, int32_t d, int32_t min, int32_t max, int32_t *lo, int32_t *hi) {
+  int64_t c = n - 1 - n / 2;
 
-  int8_t x = r;
-  int8_t y = 1;
-  int16_t radius_err = 1 - x;
+  if (d == 0) {
+    if (min > 0 || max < 0)
+      *hi = *lo - 1;
+    return;
+  }
+  if (max < 0) {
+    *hi = *lo - 1;
+    return;
+  }
+  if (min > 0 && *lo < (min * (int64_t) n - c + d - 1) / d)
+    *lo = (min * (int64_t) n - c + d - 1) / d;
+  if (*hi > ((max + 1) * (int64_t) n - c - 1) / d)
+    *hi = ((max + 1) * (int64_t) n - c - 1) / d;
+}
+
+// Bresenham line written directly into page bytes, clipped to the clip rectangle.
+// Only the visible steps are walked, starting with the error term the unclipped walk
+// would have there, so clipping never moves a pixel. Horizontal and vertical lines use
+// the span writers; steep lines collect all bits that fall into the same page byte and
+// write them at once.
+bool ssd1306_line (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, int16_t x1, int16_t y1, mgos_ssd1306_color_t color,
+                   int16_t *box) {
+  int32_t dx, dy, sx, err, i, lo, hi, n, d, m;
+  int16_t xa, ya, xb, yb;
+  uint16_t index;
+  uint8_t mask, bits = 0;
+
+  // always walk downwards, so the running mask only ever moves to the next page
+  if (y0 > y1) {
+    int16_t t;
+    t = x0;
+    x0 = x1;
+    x1 = t;
+    t = y0;
+    y0 = y1;
+    y1 = t;
+  }
+  dx = abs (x1 - x0);
+  dy = y1 - y0;
+  sx = (x0 < x1) ? 1 : -1;
+
+  // visible steps along the major axis, then along the minor one
+  if (dx >= dy) {
+    n = dx;
+    d = dy;
+    lo = (sx > 0) ? oled->clip_left - x0 : x0 - oled->clip_right;
+    hi = (sx > 0) ? oled->clip_right - x0 : x0 - oled->clip_left;
+    if (lo < 0)
+      lo = 0;
+    if (hi > n)
+      hi = n;
+    _minor_range (n, d, oled->clip_top - y0, oled->clip_bottom - y0, &lo, &hi);
+  } else {
+    n = dy;
+    d = dx;
+    lo = (oled->clip_top > y0) ? oled->clip_top - y0 : 0;
+    hi = (oled->clip_bottom < y1) ? oled->clip_bottom - y0 : n;
+    _minor_range (n, d, (sx > 0) ? oled->clip_left - x0 : x0 - oled->clip_right,
+                  (sx > 0) ? oled->clip_right - x0 : x0 - oled->clip_left, &lo, &hi);
+  }
+  if (lo > hi)
+    return false;
+
+  // end points of the visible part
+  m = n ? (int32_t) (((int64_t) lo * d + n - 1 - n / 2) / n) : 0;
+  err = n / 2 - lo * d + m * n;
+  if (dx >= dy) {
+    xa = x0 + sx * lo;
+    ya = y0 + m;
+    xb = x0 + sx * hi;
+    yb = y0 + (n ? (int32_t) (((int64_t) hi * d + n - 1 - n / 2) / n) : 0);
+  } else {
+    xa = x0 + sx * m;
+    ya = y0 + lo;
+    xb = x0 + sx * (int32_t) (((int64_t) hi * d + n - 1 - n / 2) / n);
+    yb = y0 + hi;
+  }
+  if (box != NULL) {
+    box[0] = (xa < xb) ? xa : xb;
+    box[1] = ya;
+    box[2] = (xa > xb) ? xa : xb;
+    box[3] = yb;
+  }
+
+  if (dy == 0) {
+    ssd1306_hline (oled, (xa < xb) ? xa : xb, ya, abs (xb - xa) + 1, color);
+    return true;
+  }
+  if (dx == 0) {
+    ssd1306_vline (oled, xa, ya, yb - ya + 1, color);
+    return true;
+  }
+
+  index = xa + (ya / 8) * oled->canvas_width;
+  mask = 1 << (ya & 7);
+
+  if (dx >= dy) {
+    // shallow line: one pixel per column
+    for (i = lo; i <= hi; ++i) {
+      _apply_mask (&oled->buffer[index], mask, color);
+      index += sx;
+      err -= dy;
+      if (err < 0) {
+        err += dx;
+        mask <<= 1;
+        if (mask == 0) {
+          mask = 0x01;
+          index += oled->canvas_width;
+        }
+      }
+    }
+  } else {
+    // steep line: one pixel per row, flushed whenever it leaves the current byte
+    for (i = lo; i <= hi; ++i) {
+      bool step = false;
+
+      bits |= mask;
+      err -= dx;
+      if (err < 0) {
+        err += dy;
+        step = true;
+      }
+      mask <<= 1;
+      if (step || mask == 0 || i == hi) {
+        _apply_mask (&oled->buffer[index], bits, color);
+        bits = 0;
+      }
+      if (mask == 0) {
+        mask = 0x01;
+        index += oled->canvas_width;
+      }
+      if (step)
+        index += sx;
+    }
+  }
+  return true;
+}
+
+void mgos_ssd1306_draw_line (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, int16_t x1, int16_t y1, mgos_ssd1306_color_t color) {
+  int16_t box[4];
 
   if (oled == NULL)
     return;
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x0, y0, x1, y1, color };
+    ssd1306_dl_record (oled, SSD1306_DL_LINE, args, NULL, 0);
+    return;
+  }
 
-  if (r == 0)
+  if (ssd1306_line (oled, x0, y0, x1, y1, color, box))
+    _mark_dirty (oled, box[0], box[1], box[2], box[3]);
+}
+
+void mgos_ssd1306_draw_polyline (struct mgos_ssd1306 *oled, const mgos_ssd1306_point_t *points, uint16_t count,
+                                 mgos_ssd1306_color_t color) {
+  int16_t left = INT16_MAX, top = INT16_MAX, right = -1, bottom = -1;
+
+  if (oled == NULL || points == NULL)
     return;
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { color };
+    ssd1306_dl_record (oled, SSD1306_DL_POLYLINE, args, points, count * sizeof (*points));
+    return;
+  }
 
-  mgos_ssd1306_draw_pixel (oled, x0 - r, y0, color);
-  mgos_ssd1306_draw_pixel (oled, x0 + r, y0, color);
-  mgos_ssd1306_draw_pixel (oled, x0, y0 - r, color);
-  mgos_ssd1306_draw_pixel (oled, x0, y0 + r, color);
+  if (count == 1) {
+    mgos_ssd1306_draw_pixel (oled, points[0].x, points[0].y, color);
+    return;
+  }
 
-  while (x >= y) {
-    mgos_ssd1306_draw_pixel (oled, x0 + x, y0 + y, color);
-    mgos_ssd1306_draw_pixel (oled, x0 - x, y0 + y, color);
-    mgos_ssd1306_draw_pixel (oled, x0 + x, y0 - y, color);
-    mgos_ssd1306_draw_pixel (oled, x0 - x, y0 - y, color);
-    if (x != y) {
-      /* Otherwise the 4 drawings below are the same as above, causing
-       * problem when color is INVERT
-       */
-      mgos_ssd1306_draw_pixel (oled, x0 + y, y0 + x, color);
-      mgos_ssd1306_draw_pixel (oled, x0 - y, y0 + x, color);
-      mgos_ssd1306_draw_pixel (oled, x0 + y, y0 - x, color);
-      mgos_ssd1306_draw_pixel (oled, x0 - y, y0 - x, color);
-    }
-    ++y;
-    if (radius_err < 0) {
-      radius_err += 2 * y + 1;
-    } else {
-      --x;
-      radius_err += 2 * (y - x + 1);
-    }
+  for (uint16_t i = 1; i < count; ++i) {
+    int16_t x0 = points[i - 1].x, y0 = points[i - 1].y;
+    int16_t box[4];
+
+    if (!ssd1306_line (oled, x0, y0, points[i].x, points[i].y, color, box))
+      continue;
+    // a shared vertex is drawn by both segments, which cancels out when inverting
+    if (color == SSD1306_COLOR_INVERT && i > 1 && _in_clip (oled, x0, y0))
+      _apply_mask (&oled->buffer[x0 + (y0 / 8) * oled->canvas_width], 1 << (y0 & 7), color);
+
+    if (left > box[0])
+      left = box[0];
+    if (top > box[1])
+      top = box[1];
+    if (right < box[2])
+      right = box[2];
+    if (bottom < box[3])
+      bottom = box[3];
+  }
+  if (right >= 0)
+    _mark_dirty (oled, left, top, right, bottom);
+}
 
+void mgos_ssd1306_draw_rectangle (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h, mgos_ssd1306_color_t color) {
+  if (oled == NULL)
+    return;
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x, y, w, h, color };
+    ssd1306_dl_record (oled, SSD1306_DL_RECTANGLE, args, NULL, 0);
+    return;
   }
+
+  mgos_ssd1306_draw_hline (oled, x, y, w, color);
+  mgos_ssd1306_draw_hline (oled, x, y + h - 1, w, color);
+  mgos_ssd1306_draw_vline (oled, x, y, h, color);
+  mgos_ssd1306_draw_vline (oled, x + w - 1, y, h, color);
 }
 
-void mgos_ssd1306_fill_circle (struct mgos_ssd1306 *oled, int8_t x0, int8_t y0, uint8_t r, mgos_ssd1306_color_t color) {
-  int8_t x = 1;
-  int8_t y = r;
-  int16_t radius_err = 1 - y;
-  int8_t x1;
+void mgos_ssd1306_fill_rectangle (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h, mgos_ssd1306_color_t color) {
+  int32_t left = x, top = y, right = (int32_t) x + w - 1, bottom = (int32_t) y + h - 1;
 
   if (oled == NULL)
     return;
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x, y, w, h, color };
+    ssd1306_dl_record (oled, SSD1306_DL_FILL_RECTANGLE, args, NULL, 0);
+    return;
+  }
 
-  if (r == 0)
+  if (left < oled->clip_left)
+    left = oled->clip_left;
+  if (top < oled->clip_top)
+    top = oled->clip_top;
+  if (right > oled->clip_right)
+    right = oled->clip_right;
+  if (bottom > oled->clip_bottom)
+    bottom = oled->clip_bottom;
+  if (left > right || top > bottom)
     return;
 
-  mgos_ssd1306_draw_vline (oled, x0, y0 - r, 2 * r + 1, color); // Center vertical line
-  while (y >= x) {
-    mgos_ssd1306_draw_vline (oled, x0 - x, y0 - y, 2 * y + 1, color);
-    mgos_ssd1306_draw_vline (oled, x0 + x, y0 - y, 2 * y + 1, color);
-    if (color != SSD1306_COLOR_INVERT) {
-      mgos_ssd1306_draw_vline (oled, x0 - y, y0 - x, 2 * x + 1, color);
-      mgos_ssd1306_draw_vline (oled, x0 + y, y0 - x, 2 * x + 1, color);
-    }
-    ++x;
-    if (radius_err < 0) {
-      radius_err += 2 * x + 1;
-    } else {
-      --y;
-      radius_err += 2 * (x - y + 1);
-    }
-  }
+  // one pass along each page row, with the rows of the page inside the rectangle
+  for (int32_t page = top / 8; page <= bottom / 8; ++page) {
+    uint8_t mask = 0xff;
 
-  if (color == SSD1306_COLOR_INVERT) {
-    x1 = x;                     // Save where we stopped
-
-    y = 1;
-    x = r;
-    radius_err = 1 - x;
-    mgos_ssd1306_draw_hline (oled, x0 + x1, y0, r - x1 + 1, color);
-    mgos_ssd1306_draw_hline (oled, x0 - r, y0, r - x1 + 1, color);
-    while (x >= y) {
-      mgos_ssd1306_draw_hline (oled, x0 + x1, y0 - y, x - x1 + 1, color);
-      mgos_ssd1306_draw_hline (oled, x0 + x1, y0 + y, x - x1 + 1, color);
-      mgos_ssd1306_draw_hline (oled, x0 - x, y0 - y, x - x1 + 1, color);
-      mgos_ssd1306_draw_hline (oled, x0 - x, y0 + y, x - x1 + 1, color);
-      ++y;
-      if (radius_err < 0) {
-        radius_err += 2 * y + 1;
-      } else {
-        --x;
-        radius_err += 2 * (y - x + 1);
-      }
-    }
+    if (page * 8 < top)
+      mask &= 0xff << (top - page * 8);
+    if (page * 8 + 7 > bottom)
+      mask &= 0xff >> (page * 8 + 7 - bottom);
+    ssd1306_fill_bytes (oled->buffer + page * oled->canvas_width + left, right - left + 1, mask, color);
   }
+  _mark_dirty (oled, left, top, right, bottom);
 }
 
 void mgos_ssd1306_select_font (struct mgos_ssd1306 *oled, uint8_t font) {
@@ -512,10 +829,11 @@ void mgos_ssd1306_select_font (struct mgos_ssd1306 *oled, uint8_t font) {
 }
 
 // return character width
-uint8_t mgos_ssd1306_draw_char (struct mgos_ssd1306 *oled, uint8_t x, uint8_t y, unsigned char c, mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background) {
+uint8_t mgos_ssd1306_draw_char (struct mgos_ssd1306 *oled, int16_t x, int16_t y, unsigned char c, mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background) {
   uint8_t i, j;
   const uint8_t UNUSED (*bitmap);
   uint8_t line = 0;
+  bool drawn = false;
 
   if (oled == NULL)
     return 0;
@@ -524,9 +842,19 @@ uint8_t mgos_ssd1306_draw_char (struct mgos_ssd1306 *oled, uint8_t x, uint8_t y,
     return 0;
 
   // we always have space in the font set
-  if ((c < oled->font->char_start) || (c > oled->font->char_end))
+  if ((c < (unsigned char) oled->font->char_start) || (c > (unsigned char) oled->font->char_end))
     c = ' ';
+
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x, y, c, foreground, background };
+    ssd1306_dl_record (oled, SSD1306_DL_CHAR, args, NULL, 0);
+    return (oled->font->char_descriptors[c - oled->font->char_start].width);
+  }
   c = c - oled->font->char_start;       // c now become index to tables
+  // glyphs entirely outside the clip rectangle only advance the pen
+  if (x > oled->clip_right || x + oled->font->char_descriptors[c].width <= oled->clip_left ||
+      y > oled->clip_bottom || y + oled->font->height <= oled->clip_top)
+    return (oled->font->char_descriptors[c].width);
   bitmap = oled->font->bitmap + oled->font->char_descriptors[c].offset;
   for (j = 0; j < oled->font->height; ++j) {
     for (i = 0; i < oled->font->char_descriptors[c].width; ++i) {
@@ -534,7 +862,8 @@ uint8_t mgos_ssd1306_draw_char (struct mgos_ssd1306 *oled, uint8_t x, uint8_t y,
         line = bitmap[(oled->font->char_descriptors[c].width + 7) / 8 * j + i / 8];     // line data
       }
       if (line & 0x80) {
-        mgos_ssd1306_draw_pixel (oled, x + i, y + j, foreground);
+        _plot (oled, x + i, y + j, foreground);
+        drawn = true;
       } else {
         switch (background) {
         case SSD1306_COLOR_TRANSPARENT:
@@ -542,7 +871,8 @@ uint8_t mgos_ssd1306_draw_char (struct mgos_ssd1306 *oled, uint8_t x, uint8_t y,
           break;
         case SSD1306_COLOR_WHITE:
         case SSD1306_COLOR_BLACK:
-          mgos_ssd1306_draw_pixel (oled, x + i, y + j, background);
+          _plot (oled, x + i, y + j, background);
+          drawn = true;
           break;
         case SSD1306_COLOR_INVERT:
           // I don't know why I need invert background
@@ -552,12 +882,48 @@ uint8_t mgos_ssd1306_draw_char (struct mgos_ssd1306 *oled, uint8_t x, uint8_t y,
       line = line << 1;
     }
   }
+  if (drawn)
+    _mark_dirty_clipped (oled, x, y, x + oled->font->char_descriptors[c].width - 1, y + oled->font->height - 1);
   return (oled->font->char_descriptors[c].width);
 }
 
-uint8_t mgos_ssd1306_draw_string_color (struct mgos_ssd1306 * oled, uint8_t x, uint8_t y, const char *str,
-                                        mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background) {
-  uint8_t t = x;
+void mgos_ssd1306_draw_bitmap (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h, const uint8_t *bitmap,
+                               mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background) {
+  uint16_t stride = (w + 7) / 8;
+  int32_t i0, i1, j0, j1;
+
+  if (oled == NULL || bitmap == NULL)
+    return;
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x, y, w, h, foreground, background };
+    ssd1306_dl_record (oled, SSD1306_DL_BITMAP, args, bitmap, stride * h);
+    return;
+  }
+
+  // rows and columns of the bitmap inside the clip rectangle
+  i0 = (x < oled->clip_left) ? oled->clip_left - x : 0;
+  i1 = ((int32_t) x + w - 1 > oled->clip_right) ? oled->clip_right - x : w - 1;
+  j0 = (y < oled->clip_top) ? oled->clip_top - y : 0;
+  j1 = ((int32_t) y + h - 1 > oled->clip_bottom) ? oled->clip_bottom - y : h - 1;
+  if (i0 > i1 || j0 > j1)
+    return;
+
+  for (int32_t j = j0; j <= j1; ++j) {
+    const uint8_t *row = bitmap + j * stride;
+
+    for (int32_t i = i0; i <= i1; ++i) {
+      if (row[i / 8] & (0x80 >> (i & 7)))
+        _pixel (oled, x + i, y + j, foreground);
+      else
+        _pixel (oled, x + i, y + j, background);
+    }
+  }
+  _mark_dirty (oled, x + i0, y + j0, x + i1, y + j1);
+}
+
+uint16_t mgos_ssd1306_draw_string_color (struct mgos_ssd1306 * oled, int16_t x, int16_t y, const char *str,
+                                         mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background) {
+  int16_t t = x;
 
   if (oled == NULL)
     return 0;
@@ -568,6 +934,11 @@ uint8_t mgos_ssd1306_draw_string_color (struct mgos_ssd1306 * oled, uint8_t x, u
   if (str == NULL)
     return 0;
 
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x, y, foreground, background };
+    ssd1306_dl_record (oled, SSD1306_DL_STRING, args, str, strlen (str) + 1);
+    return mgos_ssd1306_measure_string (oled, str);
+  }
   while (*str) {
     x += mgos_ssd1306_draw_char (oled, x, y, *str, foreground, background);
     ++str;
@@ -578,13 +949,13 @@ uint8_t mgos_ssd1306_draw_string_color (struct mgos_ssd1306 * oled, uint8_t x, u
   return (x - t);
 }
 
-uint8_t mgos_ssd1306_draw_string (struct mgos_ssd1306 * oled, uint8_t x, uint8_t y, const char *str) {
+uint16_t mgos_ssd1306_draw_string (struct mgos_ssd1306 * oled, int16_t x, int16_t y, const char *str) {
   return mgos_ssd1306_draw_string_color (oled, x, y, str, SSD1306_COLOR_WHITE, SSD1306_COLOR_TRANSPARENT);
 }
 
 // return width of string
-uint8_t mgos_ssd1306_measure_string (struct mgos_ssd1306 * oled, const char *str) {
-  uint8_t w = 0;
+uint16_t mgos_ssd1306_measure_string (struct mgos_ssd1306 * oled, const char *str) {
+  uint16_t w = 0;
   unsigned char c;
 
   if (oled == NULL)
@@ -596,7 +967,7 @@ uint8_t mgos_ssd1306_measure_string (struct mgos_ssd1306 * oled, const char *str
   while (*str) {
     c = *str;
     // we always have space in the font set
-    if ((c < oled->font->char_start) || (c > oled->font->char_end))
+    if ((c < (unsigned char) oled->font->char_start) || (c > (unsigned char) oled->font->char_end))
       c = ' ';
     c = c - oled->font->char_start;     // c now become index to tables
     w += oled->font->char_descriptors[c].width;
@@ -664,18 +1035,24 @@ void mgos_ssd1306_flip_display (struct mgos_ssd1306 *oled, bool horizontal, bool
 void mgos_ssd1306_update_buffer (struct mgos_ssd1306 *oled, uint8_t * data, uint16_t length) {
   if (oled == NULL)
     return;
+  if (oled->frame != NULL) {
+    LOG (LL_ERROR, ("SSD1306 has no frame buffer to update"));
+    return;
+  }
 
-  memcpy (oled->buffer, data, (length < (oled->width * oled->height / 8)) ? length : (oled->width * oled->height / 8));
-  oled->refresh_right = oled->width - 1;
-  oled->refresh_bottom = oled->height - 1;
-  oled->refresh_top = 0;
-  oled->refresh_left = 0;
+  uint16_t size = oled->canvas_width * oled->canvas_height / 8;
+  ssd1306_copy_bytes (oled->buffer, data, (length < size) ? length : size);
+  _mark_dirty (oled, 0, 0, oled->canvas_width - 1, oled->canvas_height - 1);
 }
 
 void mgos_ssd1306_command (struct mgos_ssd1306 *oled, uint8_t cmd) {
   if (oled == NULL)
     return;
 
+  // remember the contrast, so that features which change it can put it back
+  if (oled->contrast_arg)
+    oled->contrast = cmd;
+  oled->contrast_arg = (cmd == 0x81 && !oled->contrast_arg);     // SSD1306_SETCONTRAST
   _command (oled, cmd);
 }
 
@@ -0,0 +1,185 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Grayscale image dithering.
+ *
+ * Images are 8-bit gray, row-major, from a buffer or one row at a time from a
+ * callback. Each row is dithered to 1 bit per pixel and collected into one byte
+ * per column by the packer. The packer writes the bytes into the page once a row
+ * on another page comes in, or the image ends. So the frame buffer takes one
+ * masked byte write per column and page instead of eight pixel writes.
+ *
+ * Floyd-Steinberg only needs the error of the current and the next row, kept in
+ * 1/16 units. Ordered dithering uses a 4x4 Bayer matrix and needs no state. With
+ * the row buffer and the column bytes, a 128 pixel wide image takes under 1 KB of
+ * temporary memory, however tall it is.
+ */
+
+#include "ssd1306_internal.h"
+
+static const uint8_t s_bayer[4][4] = {
+  {0, 8, 2, 10},
+  {12, 4, 14, 6},
+  {3, 11, 1, 9},
+  {15, 7, 13, 5},
+};
+
+typedef struct {
+  const uint8_t *pixels;
+  uint16_t w;
+} image_buffer_t;
+
+static bool _buffer_row (uint16_t row, uint8_t *pixels, void *arg) {
+  const image_buffer_t *image = arg;
+
+  memcpy (pixels, image->pixels + (uint32_t) row * image->w, image->w);
+  return true;
+}
+
+void ssd1306_pack_flush (ssd1306_packer_t *p) {
+  struct mgos_ssd1306 *oled = p->oled;
+  int32_t top = p->page * 8;
+  uint8_t mask = p->mask;
+  uint8_t *dst;
+
+  p->mask = 0;
+  if (p->page < 0 || top >= oled->canvas_height)
+    return;
+  // rows outside the clip rectangle keep their pixels
+  for (uint8_t bit = 0; bit < 8; ++bit) {
+    if (top + bit < oled->clip_top || top + bit > oled->clip_bottom)
+      mask &= ~(1 << bit);
+  }
+  if (!mask)
+    return;
+  dst = oled->buffer + p->page * oled->canvas_width;
+  for (uint16_t i = 0; i < p->w; ++i) {
+    int32_t col = (int32_t) p->x + i;
+
+    if (col < oled->clip_left || col > oled->clip_right)
+      continue;
+    if (p->foreground == SSD1306_COLOR_WHITE && p->background == SSD1306_COLOR_BLACK) {
+      dst[col] = (dst[col] & ~mask) | (p->bits[i] & mask);
+    } else {
+      _apply_mask (&dst[col], p->bits[i] & mask, p->foreground);
+      _apply_mask (&dst[col], ~p->bits[i] & mask, p->background);
+    }
+  }
+}
+
+uint8_t ssd1306_pack_row (ssd1306_packer_t *p, int32_t y) {
+  // floor division, rows above the canvas belong to negative pages
+  int32_t page = (y >= 0) ? y / 8 : -((7 - y) / 8);
+
+  if (p->mask && page != p->page)
+    ssd1306_pack_flush (p);
+  p->page = page;
+  p->mask |= 1 << (y & 7);
+  return 1 << (y & 7);
+}
+
+void mgos_ssd1306_draw_gray_image_cb (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                      mgos_ssd1306_image_row_cb_t cb, void *arg, mgos_ssd1306_dither_t dither) {
+  ssd1306_packer_t pack = { oled, x, w, SSD1306_COLOR_WHITE, SSD1306_COLOR_BLACK, 0, 0, NULL };
+  uint8_t *row;
+  int16_t *err = NULL, *next = NULL;
+
+  if (oled == NULL || cb == NULL || w == 0 || h == 0)
+    return;
+  if (oled->dlist != NULL) {
+    LOG (LL_ERROR, ("Gray images cannot be recorded in a display list"));
+    return;
+  }
+
+  row = malloc (2 * w + ((dither == SSD1306_DITHER_FLOYD_STEINBERG) ? 2 * (w + 2) * sizeof (int16_t) : 0));
+  if (row == NULL) {
+    LOG (LL_ERROR, ("Out of memory drawing gray image"));
+    return;
+  }
+  pack.bits = row + w;
+  if (dither == SSD1306_DITHER_FLOYD_STEINBERG) {
+    // one column of margin on each side keeps the diffusion branch free
+    err = (int16_t *) (pack.bits + w);
+    next = err + w + 2;
+    memset (err, 0, 2 * (w + 2) * sizeof (int16_t));
+  }
+
+  for (uint16_t j = 0; j < h; ++j) {
+    int32_t py = (int32_t) y + j;
+    uint8_t bit;
+
+    if (!cb (j, row, arg))
+      break;
+    bit = ssd1306_pack_row (&pack, py);
+    // rows above the canvas are still dithered, for the error they pass on
+    for (uint16_t i = 0; i < w; ++i) {
+      bool on;
+
+      switch (dither) {
+      case SSD1306_DITHER_ORDERED:
+        on = row[i] > s_bayer[py & 3][(x + i) & 3] * 16 + 7;
+        break;
+      case SSD1306_DITHER_FLOYD_STEINBERG: {
+        int16_t v = row[i] + err[i + 1] / 16;
+        int16_t e;
+
+        on = v >= 128;
+        e = on ? v - 255 : v;
+        err[i + 2] += e * 7;
+        next[i] += e * 3;
+        next[i + 1] += e * 5;
+        next[i + 2] += e;
+        break;
+      }
+      default:
+        on = row[i] >= 128;
+        break;
+      }
+      if (on)
+        pack.bits[i] |= bit;
+      else
+        pack.bits[i] &= ~bit;
+    }
+    if (err != NULL) {
+      int16_t *t = err;
+
+      err = next;
+      next = t;
+      memset (next, 0, (w + 2) * sizeof (int16_t));
+    }
+  }
+  ssd1306_pack_flush (&pack);
+  free (row);
+  _mark_dirty_clipped (oled, x, y, (int32_t) x + w - 1, (int32_t) y + h - 1);
+}
+
+void mgos_ssd1306_draw_gray_image (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                   const uint8_t *pixels, mgos_ssd1306_dither_t dither) {
+  image_buffer_t image = { pixels, w };
+
+  if (pixels == NULL)
+    return;
+  mgos_ssd1306_draw_gray_image_cb (oled, x, y, w, h, _buffer_row, &image, dither);
+}
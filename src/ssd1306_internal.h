@@ -0,0 +1,266 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR 
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+/*
+ * Driver state and helpers shared by the driver sources; not part of the public API.
+ */
+
+#ifndef SSD1306_INTERNAL_H
+#define SSD1306_INTERNAL_H
+
+#include "ssd1306.h"
+
+#ifdef __GNUC__
+#define UNUSED(x) x __attribute__((unused))
+#else
+#define UNUSED(x) x
+#endif
+
+#define ARRAY_SIZE(a) (sizeof (a) / sizeof ((a)[0]))
+
+// Frame buffers start on a word boundary, so the word kernels below work on
+// aligned 32-bit words from the first few bytes of a row on
+#define SSD1306_ALIGN(n) (((n) + 3) & ~3)
+
+#ifdef __GNUC__
+typedef uint32_t __attribute__ ((may_alias)) ssd1306_word_t;
+#else
+typedef uint32_t ssd1306_word_t;
+#endif
+
+// Display list command codes
+typedef enum {
+  SSD1306_DL_PIXEL,
+  SSD1306_DL_PIXELS,
+  SSD1306_DL_HLINE,
+  SSD1306_DL_VLINE,
+  SSD1306_DL_LINE,
+  SSD1306_DL_POLYLINE,
+  SSD1306_DL_RECTANGLE,
+  SSD1306_DL_FILL_RECTANGLE,
+  SSD1306_DL_CIRCLE,
+  SSD1306_DL_ELLIPSE,
+  SSD1306_DL_FILL_ELLIPSE,
+  SSD1306_DL_ROUND_RECTANGLE,
+  SSD1306_DL_FILL_ROUND_RECTANGLE,
+  SSD1306_DL_ARC,
+  SSD1306_DL_POLYGON,
+  SSD1306_DL_TRIANGLE,
+  SSD1306_DL_CHAR,
+  SSD1306_DL_STRING,
+  SSD1306_DL_BITMAP,
+  SSD1306_DL_CLIP,
+} ssd1306_dl_op_t;
+
+typedef struct mgos_ssd1306 {
+  uint8_t address;              // I2C address
+  uint8_t width;                // panel width
+  uint8_t height;               // panel height
+  uint8_t col_offset;           // some displays have panel's starting column
+                                // connected to seg pin other than 0.
+  uint8_t com_pins;             // COM pins configuration
+  uint8_t contrast;             // contrast last sent, see mgos_ssd1306_command()
+  bool contrast_arg;            // the next command byte is a contrast value
+  uint16_t canvas_width;        // drawing canvas width, at least panel width
+  uint16_t canvas_height;       // drawing canvas height, at least panel height
+  uint16_t rotation;            // software rotation in degrees: 0, or 90 and 270 for portrait
+  int16_t view_x;               // panel viewport origin within the canvas
+  int16_t view_y;
+  int16_t refresh_top;          // 'Dirty' window corners, canvas coordinates
+  int16_t refresh_left;
+  int16_t refresh_right;
+  int16_t refresh_bottom;
+  int16_t clip_left;            // drawing clip rectangle, inclusive canvas coordinates
+  int16_t clip_top;
+  int16_t clip_right;
+  int16_t clip_bottom;
+  const font_info_t *font;      // current font
+  struct mgos_ssd1306_dlist *dlist;     // display list being recorded, drawing calls go there
+  struct mgos_ssd1306_dlist *frame;     // paged mode: display list of the screen contents
+  struct mgos_ssd1306_dlist *shown;     // display list that produced the canvas
+  struct mgos_ssd1306_widget *widgets;  // retained widgets, in drawing order
+  struct mgos_ssd1306_layer *layers;    // layers above the canvas, bottom to top
+  uint8_t *composite;           // layers composited for sending, NULL without layers
+  struct mgos_ssd1306_gray *gray;       // gray canvas, sent instead of the canvas
+  struct mgos_ssd1306_canvas *target;   // offscreen canvas selected for drawing, NULL for none
+  uint8_t *saved;               // stack of saved regions, see mgos_ssd1306_push_region()
+  uint32_t saved_len;           // bytes of the stack in use
+  uint32_t saved_size;          // bytes allocated
+  struct mgos_ssd1306_screen *screens;  // cached screens, see mgos_ssd1306_screen_store()
+  struct mgos_i2c *i2c;         // i2c connection
+  uint8_t *line;                // scratch page for unaligned viewports, portrait and paged mode
+  uint8_t *buffer;              // drawing buffer: the canvas or the selected layer; in paged
+                                // mode, set while a page is rendered
+} mgos_ssd1306;
+
+// The driver canvas follows the driver state in the same allocation
+static inline uint8_t *_canvas (struct mgos_ssd1306 *oled) {
+  return (uint8_t *) oled + SSD1306_ALIGN (sizeof (*oled));
+}
+
+static inline void _reset_dirty (struct mgos_ssd1306 *oled) {
+  oled->refresh_top = INT16_MAX;
+  oled->refresh_left = INT16_MAX;
+  oled->refresh_right = -1;
+  oled->refresh_bottom = -1;
+}
+
+static inline void _mark_dirty (struct mgos_ssd1306 *oled, int16_t left, int16_t top, int16_t right, int16_t bottom) {
+  if (oled->refresh_left > left)
+    oled->refresh_left = left;
+  if (oled->refresh_right < right)
+    oled->refresh_right = right;
+  if (oled->refresh_top > top)
+    oled->refresh_top = top;
+  if (oled->refresh_bottom < bottom)
+    oled->refresh_bottom = bottom;
+}
+
+static inline void _apply_mask (uint8_t *dst, uint8_t mask, mgos_ssd1306_color_t color) {
+  switch (color) {
+  case SSD1306_COLOR_WHITE:
+    *dst |= mask;
+    break;
+  case SSD1306_COLOR_BLACK:
+    *dst &= ~mask;
+    break;
+  case SSD1306_COLOR_INVERT:
+    *dst ^= mask;
+    break;
+  default:
+    break;
+  }
+}
+
+// Advance of a glyph of the font, characters outside the font are drawn as space
+static inline uint8_t _glyph_width (const font_info_t *font, unsigned char c) {
+  if (c < (unsigned char) font->char_start || c > (unsigned char) font->char_end)
+    c = ' ';
+  return font->char_descriptors[c - font->char_start].width;
+}
+
+static inline void _reset_clip (struct mgos_ssd1306 *oled) {
+  oled->clip_left = 0;
+  oled->clip_top = 0;
+  oled->clip_right = oled->canvas_width - 1;
+  oled->clip_bottom = oled->canvas_height - 1;
+}
+
+static inline bool _in_clip (struct mgos_ssd1306 *oled, int16_t x, int16_t y) {
+  return x >= oled->clip_left && x <= oled->clip_right && y >= oled->clip_top && y <= oled->clip_bottom;
+}
+
+// Mark a region dirty after clipping it to the clip rectangle
+static inline void _mark_dirty_clipped (struct mgos_ssd1306 *oled, int16_t left, int16_t top, int16_t right, int16_t bottom) {
+  if (left < oled->clip_left)
+    left = oled->clip_left;
+  if (top < oled->clip_top)
+    top = oled->clip_top;
+  if (right > oled->clip_right)
+    right = oled->clip_right;
+  if (bottom > oled->clip_bottom)
+    bottom = oled->clip_bottom;
+  if (left <= right && top <= bottom)
+    _mark_dirty (oled, left, top, right, bottom);
+}
+
+// Unchecked pixel write; the caller clips and marks the dirty region
+static inline void _pixel (struct mgos_ssd1306 *oled, int16_t x, int16_t y, mgos_ssd1306_color_t color) {
+  _apply_mask (&oled->buffer[x + (y / 8) * oled->canvas_width], 1 << (y & 7), color);
+}
+
+// Pixel write that drops pixels outside the clip rectangle; the caller marks the dirty region
+static inline void _plot (struct mgos_ssd1306 *oled, int16_t x, int16_t y, mgos_ssd1306_color_t color) {
+  if (_in_clip (oled, x, y))
+    _pixel (oled, x, y, color);
+}
+
+// Word-at-a-time kernels over n consecutive bytes of a page row. fill applies mask in
+// color to every byte, copy copies, and diff finds the first and last byte that
+// differs, returning false when there is none.
+void ssd1306_fill_bytes (uint8_t *dst, uint16_t n, uint8_t mask, mgos_ssd1306_color_t color);
+void ssd1306_copy_bytes (uint8_t *dst, const uint8_t *src, uint16_t n);
+bool ssd1306_diff_bytes (const uint8_t *a, const uint8_t *b, uint16_t n, uint16_t *first, uint16_t *last);
+
+// Unchecked drawing helpers; coordinates must be inside the clip rectangle and the caller
+// marks the dirty region.
+void ssd1306_hline (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, mgos_ssd1306_color_t color);
+void ssd1306_vline (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t h, mgos_ssd1306_color_t color);
+
+// Line clipped to the clip rectangle; the pixels inside it are exactly those of the
+// unclipped line. Returns false if nothing is visible, otherwise box receives the
+// left, top, right and bottom of the visible part. The caller marks the dirty region.
+bool ssd1306_line (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, int16_t x1, int16_t y1, mgos_ssd1306_color_t color,
+                   int16_t *box);
+
+// Send len bytes of a panel page, starting at column col
+void ssd1306_write_page (struct mgos_ssd1306 *oled, uint8_t page, uint8_t col, uint8_t len, const uint8_t *data);
+
+// Portrait refresh: transpose the canvas under the dirty window, or all of it when
+// forced, into panel pages and send them
+void ssd1306_rotate_refresh (struct mgos_ssd1306 *oled, bool force);
+
+// Paged mode frame handling: clear empties the screen's display list, refresh
+// renders and sends the pages that changed since the last refresh.
+void ssd1306_dl_clear (struct mgos_ssd1306 *oled);
+void ssd1306_dl_refresh (struct mgos_ssd1306 *oled, bool force);
+
+// Collects 1bpp image rows into one byte per column and writes them into the frame
+// buffer a page at a time, clipped, with set bits in the foreground color and clear
+// bits in the background color. Rows may come in any order; x and w are fixed.
+typedef struct {
+  struct mgos_ssd1306 *oled;
+  int16_t x;
+  uint16_t w;
+  mgos_ssd1306_color_t foreground;
+  mgos_ssd1306_color_t background;
+  int32_t page;                 // page being collected
+  uint8_t mask;                 // rows of the page collected so far
+  uint8_t *bits;                // w column bytes
+} ssd1306_packer_t;
+
+// Start row y, returns its bit in the column bytes; the caller then sets or clears
+// that bit of every column byte
+uint8_t ssd1306_pack_row (ssd1306_packer_t *p, int32_t y);
+
+// Write the rows collected so far; the caller marks the dirty region
+void ssd1306_pack_flush (ssd1306_packer_t *p);
+
+// Free all widgets of a driver
+void ssd1306_widgets_free (struct mgos_ssd1306 *oled);
+
+// Free all cached screens of a driver
+void ssd1306_screens_free (struct mgos_ssd1306 *oled);
+
+// Composite the canvas and the visible layers into the composite buffer, over
+// columns left to right of pages page_start to page_end, canvas coordinates
+void ssd1306_layers_composite (struct mgos_ssd1306 *oled, int16_t left, uint16_t page_start, int16_t right, uint16_t page_end);
+
+// Free all layers of a driver and select the canvas for drawing
+void ssd1306_layers_free (struct mgos_ssd1306 *oled);
+
+// Append a drawing call to the display list being recorded. args holds the call's
+// scalar arguments in declaration order, data the point array or string, if any.
+void ssd1306_dl_record (struct mgos_ssd1306 *oled, ssd1306_dl_op_t op, const int16_t *args, const void *data, uint32_t len);
+
+#endif /* SSD1306_INTERNAL_H */
@@ -0,0 +1,216 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Layers.
+ *
+ * The driver's own canvas is the bottom layer. Layers created on top of it are
+ * canvas-sized 1bpp buffers in the same page-major layout, optionally with a mask
+ * of the same size. Selecting a layer points the driver's drawing buffer at its
+ * pixels or its mask, so every primitive can draw into it, and the dirty window
+ * keeps track of what changed in any layer.
+ *
+ * Refresh composites the part of the canvas it is about to send into a separate
+ * buffer, bottom to top: an unmasked layer sets its white pixels
+ * (out |= pixels), a masked one replaces the pixels under its mask
+ * (out = (out & ~mask) | (pixels & mask)). All buffers are word aligned and share
+ * the layout, so rows are combined 32 bits at a time. Erasing a cursor or a toast
+ * from its layer uncovers the content below without redrawing it.
+ */
+
+#include "ssd1306_internal.h"
+
+struct mgos_ssd1306_layer {
+  struct mgos_ssd1306_layer *next;      // next layer up
+  struct mgos_ssd1306 *oled;
+  bool visible;
+  uint8_t *mask;                        // NULL when the layer ORs over the layers below
+  uint8_t *pixels;                      // word aligned, after the layer state
+};
+
+static inline uint32_t _canvas_size (struct mgos_ssd1306 *oled) {
+  return (uint32_t) oled->canvas_width * oled->canvas_height / 8;
+}
+
+// Mark the page rows and columns a layer covers dirty
+static void _mark_extent (struct mgos_ssd1306_layer *layer) {
+  struct mgos_ssd1306 *oled = layer->oled;
+
+  for (uint16_t page = 0; page < oled->canvas_height / 8; ++page) {
+    const uint8_t *p = layer->pixels + page * oled->canvas_width;
+    const uint8_t *m = layer->mask ? layer->mask + page * oled->canvas_width : p;
+    int16_t left = 0, right = oled->canvas_width - 1;
+
+    while (left <= right && !(p[left] | m[left]))
+      left++;
+    while (right > left && !(p[right] | m[right]))
+      right--;
+    if (left <= right)
+      _mark_dirty (oled, left, page * 8, right, page * 8 + 7);
+  }
+}
+
+// dst = (dst & ~mask) | (src & mask), or dst |= src without a mask. The three
+// pointers have the same alignment, so everything after the first few bytes is
+// done a word at a time.
+static void _blend (uint8_t *dst, const uint8_t *src, const uint8_t *mask, uint16_t n) {
+  for (; n && ((uintptr_t) dst & 3); --n, ++dst, ++src) {
+    if (mask != NULL) {
+      *dst = (*dst & ~*mask) | (*src & *mask);
+      ++mask;
+    } else {
+      *dst |= *src;
+    }
+  }
+  for (; n >= 4; n -= 4, dst += 4, src += 4) {
+    ssd1306_word_t *d = (ssd1306_word_t *) dst;
+    const ssd1306_word_t *s = (const ssd1306_word_t *) src;
+
+    if (mask != NULL) {
+      *d = (*d & ~*(const ssd1306_word_t *) mask) | (*s & *(const ssd1306_word_t *) mask);
+      mask += 4;
+    } else {
+      *d |= *s;
+    }
+  }
+  for (; n; --n, ++dst, ++src) {
+    if (mask != NULL) {
+      *dst = (*dst & ~*mask) | (*src & *mask);
+      ++mask;
+    } else {
+      *dst |= *src;
+    }
+  }
+}
+
+void ssd1306_layers_composite (struct mgos_ssd1306 *oled, int16_t left, uint16_t page_start, int16_t right, uint16_t page_end) {
+  uint16_t n = right - left + 1;
+
+  if (page_end >= oled->canvas_height / 8)
+    page_end = oled->canvas_height / 8 - 1;
+  for (uint16_t page = page_start; page <= page_end; ++page) {
+    uint16_t offset = page * oled->canvas_width + left;
+
+    ssd1306_copy_bytes (oled->composite + offset, _canvas (oled) + offset, n);
+    for (struct mgos_ssd1306_layer *layer = oled->layers; layer != NULL; layer = layer->next) {
+      if (layer->visible)
+        _blend (oled->composite + offset, layer->pixels + offset, layer->mask ? layer->mask + offset : NULL, n);
+    }
+  }
+}
+
+void ssd1306_layers_free (struct mgos_ssd1306 *oled) {
+  while (oled->layers != NULL) {
+    struct mgos_ssd1306_layer *layer = oled->layers;
+
+    oled->layers = layer->next;
+    free (layer);
+  }
+  free (oled->composite);
+  oled->composite = NULL;
+  oled->buffer = _canvas (oled);
+}
+
+struct mgos_ssd1306_layer *mgos_ssd1306_layer_create (struct mgos_ssd1306 *oled, bool masked) {
+  struct mgos_ssd1306_layer *layer, **tail;
+  uint32_t size;
+
+  if (oled == NULL)
+    return NULL;
+  if (oled->frame != NULL || oled->gray != NULL) {
+    LOG (LL_ERROR, ("Layers need a frame buffer and no gray canvas"));
+    return NULL;
+  }
+
+  if (oled->composite == NULL) {
+    oled->composite = malloc (_canvas_size (oled));
+    if (oled->composite == NULL) {
+      LOG (LL_ERROR, ("Out of memory creating layer"));
+      return NULL;
+    }
+  }
+  // the mask starts at a word boundary like the pixels
+  size = SSD1306_ALIGN (_canvas_size (oled));
+  layer = calloc (1, SSD1306_ALIGN (sizeof (*layer)) + (masked ? 2 : 1) * size);
+  if (layer == NULL) {
+    LOG (LL_ERROR, ("Out of memory creating layer"));
+    if (oled->layers == NULL) {
+      free (oled->composite);
+      oled->composite = NULL;
+    }
+    return NULL;
+  }
+  layer->oled = oled;
+  layer->visible = true;
+  layer->pixels = (uint8_t *) layer + SSD1306_ALIGN (sizeof (*layer));
+  if (masked)
+    layer->mask = layer->pixels + size;
+  for (tail = &oled->layers; *tail != NULL; tail = &(*tail)->next);
+  *tail = layer;
+  return layer;
+}
+
+void mgos_ssd1306_layer_free (struct mgos_ssd1306_layer *layer) {
+  struct mgos_ssd1306 *oled;
+  struct mgos_ssd1306_layer **p;
+
+  if (layer == NULL)
+    return;
+
+  oled = layer->oled;
+  if (layer->visible)
+    _mark_extent (layer);
+  if (oled->buffer == layer->pixels || oled->buffer == layer->mask)
+    oled->buffer = _canvas (oled);
+  for (p = &oled->layers; *p != layer; p = &(*p)->next);
+  *p = layer->next;
+  free (layer);
+  if (oled->layers == NULL) {
+    // back to sending the canvas itself
+    free (oled->composite);
+    oled->composite = NULL;
+  }
+}
+
+void mgos_ssd1306_select_layer (struct mgos_ssd1306 *oled, struct mgos_ssd1306_layer *layer, bool mask) {
+  if (oled == NULL || oled->frame != NULL)
+    return;
+  // layers belong to the driver canvas
+  mgos_ssd1306_select_canvas (oled, NULL);
+
+  if (layer == NULL)
+    oled->buffer = _canvas (oled);
+  else if (mask && layer->mask != NULL)
+    oled->buffer = layer->mask;
+  else
+    oled->buffer = layer->pixels;
+}
+
+void mgos_ssd1306_layer_set_visible (struct mgos_ssd1306_layer *layer, bool visible) {
+  if (layer == NULL || layer->visible == visible)
+    return;
+
+  layer->visible = visible;
+  _mark_extent (layer);
+}
@@ -0,0 +1,345 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Streaming monochrome image loader: PBM (P1 and P4), XBM and uncompressed 1bpp BMP.
+ *
+ * Files are read through a small chunk buffer. Each row is decoded into a 1bpp row
+ * buffer and handed to the page packer, which turns row-major bits into page bytes
+ * and writes them clipped at the destination. Memory use is one row of bits plus
+ * one byte per column, whatever the image height. BMP rows stored bottom-up are
+ * fine, because the packer accepts rows in any order.
+ *
+ * Ink pixels are drawn in the foreground color: 1 bits in PBM and XBM, and in BMP
+ * the darker of the two palette entries. The other pixels are drawn in the
+ * background color.
+ */
+
+#include <stdio.h>
+
+#include "ssd1306_internal.h"
+
+#define LOADER_CHUNK 64
+#define LOADER_MAX_SIZE 4096    // sanity limit for image width and height
+
+typedef struct {
+  FILE *fp;
+  uint8_t pos;
+  uint8_t len;
+  uint8_t buf[LOADER_CHUNK];
+} reader_t;
+
+typedef enum {
+  IMAGE_PBM_ASCII,
+  IMAGE_PBM_RAW,
+  IMAGE_XBM,
+  IMAGE_BMP,
+} image_format_t;
+
+typedef struct {
+  image_format_t format;
+  int32_t w;
+  int32_t h;
+  bool bottom_up;               // BMP rows are stored last row first
+  bool invert;                  // BMP 0 bits are ink
+  uint32_t stride;              // BMP bytes per stored row
+} image_info_t;
+
+static int _getc (reader_t *r) {
+  if (r->pos == r->len) {
+    r->len = fread (r->buf, 1, sizeof (r->buf), r->fp);
+    r->pos = 0;
+    if (r->len == 0)
+      return EOF;
+  }
+  return r->buf[r->pos++];
+}
+
+static bool _skip (reader_t *r, uint32_t n) {
+  while (n--) {
+    if (_getc (r) == EOF)
+      return false;
+  }
+  return true;
+}
+
+static uint32_t _le (reader_t *r, uint8_t n) {
+  uint32_t v = 0;
+
+  for (uint8_t i = 0; i < n; ++i)
+    v |= (uint32_t) (_getc (r) & 0xff) << (8 * i);
+  return v;
+}
+
+// Next PBM header number, skipping white space and comments; -1 on error
+static int32_t _pbm_uint (reader_t *r) {
+  int c = _getc (r);
+  int32_t v = 0;
+
+  for (;;) {
+    if (c == '#') {
+      while (c != '\n' && c != EOF)
+        c = _getc (r);
+    } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+      c = _getc (r);
+    } else {
+      break;
+    }
+  }
+  if (c < '0' || c > '9')
+    return -1;
+  while (c >= '0' && c <= '9' && v <= LOADER_MAX_SIZE) {
+    v = v * 10 + (c - '0');
+    c = _getc (r);
+  }
+  // a single white space character ends the header of a raw PBM
+  return v;
+}
+
+// Next number of the XBM data array, -1 at the closing brace or on error
+static int32_t _xbm_byte (reader_t *r) {
+  int c = _getc (r);
+  int32_t v = 0;
+  uint8_t base = 10;
+
+  while (c != EOF && c != '}' && !(c >= '0' && c <= '9'))
+    c = _getc (r);
+  if (c == EOF || c == '}')
+    return -1;
+  if (c == '0') {
+    c = _getc (r);
+    if (c == 'x' || c == 'X') {
+      base = 16;
+      c = _getc (r);
+    }
+  }
+  for (;; c = _getc (r)) {
+    if (c >= '0' && c <= '9')
+      v = v * base + (c - '0');
+    else if (base == 16 && (c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+      v = v * base + ((c | 0x20) - 'a' + 10);
+    else
+      break;
+  }
+  return v & 0xff;
+}
+
+// XBM header: "#define name_width 16" and "#define name_height 16" up to the '{'
+static bool _xbm_header (reader_t *r, image_info_t *info) {
+  char token[32];
+  uint8_t len = 0;
+  int c;
+
+  info->w = info->h = -1;
+  while ((c = _getc (r)) != EOF && c != '{') {
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_') {
+      // keep the end of long identifiers, that is where the suffix is
+      if (len == sizeof (token) - 1) {
+        memmove (token, token + 1, len - 1);
+        len--;
+      }
+      token[len++] = c;
+      continue;
+    }
+    token[len] = '\0';
+    if (len > 6 && strcmp (token + len - 6, "_width") == 0)
+      info->w = _pbm_uint (r);
+    else if (len > 7 && strcmp (token + len - 7, "_height") == 0)
+      info->h = _pbm_uint (r);
+    len = 0;
+  }
+  return c == '{';
+}
+
+static bool _bmp_header (reader_t *r, image_info_t *info) {
+  uint32_t offset, header, palette_size, compression = 0, read;
+  uint32_t color[2] = { 0, 0 };
+  uint16_t planes, bpp;
+
+  _skip (r, 8);                 // file size, reserved
+  offset = _le (r, 4);
+  header = _le (r, 4);
+  if (header == 12) {
+    info->w = (int16_t) _le (r, 2);
+    info->h = (int16_t) _le (r, 2);
+    planes = _le (r, 2);
+    bpp = _le (r, 2);
+    palette_size = 3;
+  } else if (header >= 40) {
+    info->w = (int32_t) _le (r, 4);
+    info->h = (int32_t) _le (r, 4);
+    planes = _le (r, 2);
+    bpp = _le (r, 2);
+    compression = _le (r, 4);
+    _skip (r, header - 20);
+    palette_size = 4;
+  } else {
+    return false;
+  }
+  if (planes != 1 || bpp != 1 || compression != 0)
+    return false;
+  info->bottom_up = info->h > 0;
+  if (info->h < 0)
+    info->h = -info->h;
+  for (uint8_t i = 0; i < 2; ++i) {
+    color[i] = _le (r, 3);
+    _skip (r, palette_size - 3);
+  }
+  // ink is the darker entry, by the sum of blue, green and red
+  info->invert = ((color[0] & 0xff) + ((color[0] >> 8) & 0xff) + (color[0] >> 16)) <
+    ((color[1] & 0xff) + ((color[1] >> 8) & 0xff) + (color[1] >> 16));
+  info->stride = (((uint32_t) info->w + 31) / 32) * 4;
+  read = 14 + header + 2 * palette_size;
+  return offset >= read && _skip (r, offset - read);
+}
+
+static bool _header (reader_t *r, image_info_t *info) {
+  int c0 = _getc (r), c1 = _getc (r);
+
+  if (c0 == 'P' && (c1 == '1' || c1 == '4')) {
+    info->format = (c1 == '1') ? IMAGE_PBM_ASCII : IMAGE_PBM_RAW;
+    info->w = _pbm_uint (r);
+    info->h = _pbm_uint (r);
+    return true;
+  }
+  if (c0 == 'B' && c1 == 'M') {
+    info->format = IMAGE_BMP;
+    return _bmp_header (r, info);
+  }
+  if (c0 == '#') {
+    info->format = IMAGE_XBM;
+    return _xbm_header (r, info);
+  }
+  return false;
+}
+
+// Read the next stored row into row, MSB first, set bits are ink
+static bool _read_row (reader_t *r, const image_info_t *info, uint8_t *row) {
+  uint16_t bytes = (info->w + 7) / 8;
+  int c;
+
+  switch (info->format) {
+  case IMAGE_PBM_ASCII:
+    memset (row, 0, bytes);
+    for (int32_t i = 0; i < info->w; ++i) {
+      do {
+        c = _getc (r);
+      } while (c != EOF && c != '0' && c != '1');
+      if (c == EOF)
+        return false;
+      if (c == '1')
+        row[i / 8] |= 0x80 >> (i & 7);
+    }
+    return true;
+  case IMAGE_PBM_RAW:
+    for (uint16_t i = 0; i < bytes; ++i) {
+      if ((c = _getc (r)) == EOF)
+        return false;
+      row[i] = c;
+    }
+    return true;
+  case IMAGE_XBM:
+    for (uint16_t i = 0; i < bytes; ++i) {
+      int32_t v = _xbm_byte (r);
+      uint8_t b = 0;
+
+      if (v < 0)
+        return false;
+      // XBM stores the leftmost pixel in the lowest bit
+      for (uint8_t bit = 0; bit < 8; ++bit) {
+        if (v & (1 << bit))
+          b |= 0x80 >> bit;
+      }
+      row[i] = b;
+    }
+    return true;
+  case IMAGE_BMP:
+    for (uint16_t i = 0; i < bytes; ++i) {
+      if ((c = _getc (r)) == EOF)
+        return false;
+      row[i] = info->invert ? ~c : c;
+    }
+    return _skip (r, info->stride - bytes);
+  }
+  return false;
+}
+
+bool mgos_ssd1306_draw_image_file (struct mgos_ssd1306 *oled, int16_t x, int16_t y, const char *path,
+                                   mgos_ssd1306_color_t foreground, mgos_ssd1306_color_t background) {
+  reader_t reader = { 0 };
+  image_info_t info = { 0 };
+  ssd1306_packer_t pack = { oled, x, 0, foreground, background, 0, 0, NULL };
+  uint8_t *row;
+  bool ok = true;
+
+  if (oled == NULL || path == NULL)
+    return false;
+  if (oled->dlist != NULL) {
+    LOG (LL_ERROR, ("Image files cannot be recorded in a display list"));
+    return false;
+  }
+
+  reader.fp = fopen (path, "rb");
+  if (reader.fp == NULL) {
+    LOG (LL_ERROR, ("Cannot open image %s", path));
+    return false;
+  }
+  if (!_header (&reader, &info) || info.w <= 0 || info.h <= 0 || info.w > LOADER_MAX_SIZE || info.h > LOADER_MAX_SIZE) {
+    LOG (LL_ERROR, ("%s: not a supported monochrome image", path));
+    fclose (reader.fp);
+    return false;
+  }
+
+  row = malloc ((info.w + 7) / 8 + info.w);
+  if (row == NULL) {
+    LOG (LL_ERROR, ("Out of memory loading image %s", path));
+    fclose (reader.fp);
+    return false;
+  }
+  pack.w = info.w;
+  pack.bits = row + (info.w + 7) / 8;
+
+  for (int32_t j = 0; j < info.h; ++j) {
+    int32_t py = (int32_t) y + (info.bottom_up ? info.h - 1 - j : j);
+    uint8_t bit;
+
+    if (!_read_row (&reader, &info, row)) {
+      LOG (LL_ERROR, ("%s: truncated image", path));
+      ok = false;
+      break;
+    }
+    bit = ssd1306_pack_row (&pack, py);
+    for (int32_t i = 0; i < info.w; ++i) {
+      if (row[i / 8] & (0x80 >> (i & 7)))
+        pack.bits[i] |= bit;
+      else
+        pack.bits[i] &= ~bit;
+    }
+  }
+  ssd1306_pack_flush (&pack);
+  free (row);
+  fclose (reader.fp);
+  _mark_dirty_clipped (oled, x, y, (int32_t) x + info.w - 1, (int32_t) y + info.h - 1);
+  return ok;
+}
@@ -0,0 +1,315 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+/*
+ * Scanline polygon fill.
+ *
+ * The edge table is built once per shape. Rows are then processed one page (8 rows)
+ * at a time: the spans of all rows in the page are turned into start/end events,
+ * sorted by X and swept left to right, so every run of columns that shares the same
+ * bit pattern is written with a single mask and each framebuffer byte is touched at
+ * most once per page.
+ *
+ * A pixel is filled when its center is inside the polygon (even-odd rule) or when
+ * it is on an edge as ssd1306_line() steps it, so the fill covers every pixel of
+ * the outline drawn with lines between the same points.
+ */
+
+#include "ssd1306_internal.h"
+
+typedef struct {
+  int16_t ya;                   // top row
+  int16_t yb;                   // bottom row, yb >= ya
+  int32_t xa;                   // X at ya, 16.16 fixed point
+  int32_t xb;                   // X at yb, 16.16 fixed point
+  int32_t slope;                // X step per half row, 16.16 fixed point
+} poly_edge_t;
+
+typedef struct {
+  int16_t x;                    // column where the row bit switches on or off
+  int8_t delta;                 // +1 span start, -1 one past span end
+  uint8_t row;                  // row within the page
+} poly_event_t;
+
+// Working storage for one shape
+typedef struct {
+  poly_edge_t *edges;
+  uint16_t num_edges;
+  uint16_t *active;             // active edge table, indices into edges
+  int32_t *cross;               // parity crossings of the current row
+  poly_event_t *events;         // events of the current page
+  uint16_t num_events;
+} poly_ctx_t;
+
+// Events needed per polygon vertex: each row of a page has at most one outline
+// span per edge and one interior span per two edges, two events per span.
+#define POLY_EVENTS_PER_VERTEX (8 * 3)
+
+#define FP_FLOOR(v) ((int16_t) ((v) >> 16))
+#define FP_CEIL(v)  ((int16_t) (((v) + 0xffff) >> 16))
+
+// X of the edge at half row y2 (row * 2), clamped to the edge's extent
+static int32_t _edge_x (const poly_edge_t *e, int32_t y2) {
+  if (y2 <= 2 * e->ya)
+    return e->xa;
+  if (y2 >= 2 * e->yb)
+    return e->xb;
+  return e->xa + (int32_t) ((int64_t) e->slope * (y2 - 2 * e->ya));
+}
+
+// Columns of row y on an edge, stepped like ssd1306_line(): from the top end, after
+// k steps along the major axis of length n the minor axis offset is (k * d + c) / n
+static void _edge_span (const poly_edge_t *e, int16_t y, int16_t *left, int16_t *right) {
+  int32_t xa = FP_FLOOR (e->xa), xb = FP_FLOOR (e->xb);
+  int32_t dx = abs (xb - xa), dy = e->yb - e->ya, sx = (xa < xb) ? 1 : -1;
+  int64_t r = y - e->ya, c, lo, hi;
+
+  if (dy == 0) {
+    *left = (xa < xb) ? xa : xb;
+    *right = (xa < xb) ? xb : xa;
+    return;
+  }
+  if (dx < dy) {
+    // steep: one pixel per row
+    c = dy - 1 - dy / 2;
+    *left = *right = xa + sx * (int32_t) ((r * dx + c) / dy);
+    return;
+  }
+  // shallow: the steps whose row offset is r
+  c = dx - 1 - dx / 2;
+  lo = (r * dx - c + dy - 1) / dy;
+  hi = ((r + 1) * dx - c - 1) / dy;
+  if (lo < 0)
+    lo = 0;
+  if (hi > dx)
+    hi = dx;
+  *left = xa + sx * (int32_t) ((sx > 0) ? lo : hi);
+  *right = xa + sx * (int32_t) ((sx > 0) ? hi : lo);
+}
+
+static int _event_cmp (const void *a, const void *b) {
+  return ((const poly_event_t *) a)->x - ((const poly_event_t *) b)->x;
+}
+
+static void _add_span (struct mgos_ssd1306 *oled, poly_ctx_t *ctx, int16_t x0, int16_t x1, uint8_t row) {
+  if (x0 > x1 || x1 < oled->clip_left || x0 > oled->clip_right)
+    return;
+  if (x0 < oled->clip_left)
+    x0 = oled->clip_left;
+  if (x1 > oled->clip_right)
+    x1 = oled->clip_right;
+  ctx->events[ctx->num_events].x = x0;
+  ctx->events[ctx->num_events].delta = 1;
+  ctx->events[ctx->num_events].row = row;
+  ++ctx->num_events;
+  ctx->events[ctx->num_events].x = x1 + 1;
+  ctx->events[ctx->num_events].delta = -1;
+  ctx->events[ctx->num_events].row = row;
+  ++ctx->num_events;
+}
+
+// Sweep the events of one page and write each run of equal masks in one pass
+static void _flush_page (struct mgos_ssd1306 *oled, poly_ctx_t *ctx, int16_t page, mgos_ssd1306_color_t color) {
+  uint8_t count[8] = { 0 };
+  uint8_t mask = 0;
+  uint16_t i = 0;
+  uint8_t *row = oled->buffer + page * oled->canvas_width;
+
+  qsort (ctx->events, ctx->num_events, sizeof (poly_event_t), _event_cmp);
+  while (i < ctx->num_events) {
+    int16_t x = ctx->events[i].x;
+    int16_t next;
+
+    do {
+      count[ctx->events[i].row] += ctx->events[i].delta;
+      if (count[ctx->events[i].row])
+        mask |= 1 << ctx->events[i].row;
+      else
+        mask &= ~(1 << ctx->events[i].row);
+      ++i;
+    } while (i < ctx->num_events && ctx->events[i].x == x);
+
+    if (mask == 0 || i == ctx->num_events)
+      continue;
+    next = ctx->events[i].x;
+    ssd1306_fill_bytes (row + x, next - x, mask, color);
+  }
+  ctx->num_events = 0;
+}
+
+// Collect the spans of one row into the page events
+static void _scan_row (struct mgos_ssd1306 *oled, poly_ctx_t *ctx, uint16_t num_active, int16_t y, uint8_t row) {
+  uint16_t num_cross = 0;
+
+  for (uint16_t i = 0; i < num_active; ++i) {
+    const poly_edge_t *e = &ctx->edges[ctx->active[i]];
+    int32_t x = _edge_x (e, 2 * y);
+    int16_t left, right;
+
+    _edge_span (e, y, &left, &right);
+    _add_span (oled, ctx, left, right, row);
+
+    // interior crossings; edges own their top row but not their bottom row
+    if (y < e->yb) {
+      uint16_t j = num_cross++;
+      while (j > 0 && ctx->cross[j - 1] > x) {
+        ctx->cross[j] = ctx->cross[j - 1];
+        --j;
+      }
+      ctx->cross[j] = x;
+    }
+  }
+
+  for (uint16_t i = 0; i + 1 < num_cross; i += 2)
+    _add_span (oled, ctx, FP_CEIL (ctx->cross[i]), FP_FLOOR (ctx->cross[i + 1]), row);
+}
+
+static void _fill_polygon (struct mgos_ssd1306 *oled, poly_ctx_t *ctx, const mgos_ssd1306_point_t *points, uint16_t count,
+                           mgos_ssd1306_color_t color) {
+  int16_t left = INT16_MAX, right = INT16_MIN, top = INT16_MAX, bottom = INT16_MIN;
+  uint16_t next_edge = 0, num_active = 0;
+
+  // build the edge table, sorted by top row
+  ctx->num_edges = 0;
+  ctx->num_events = 0;
+  for (uint16_t i = 0; i < count; ++i) {
+    const mgos_ssd1306_point_t *a = &points[i];
+    const mgos_ssd1306_point_t *b = &points[(i + 1) % count];
+    poly_edge_t e;
+    uint16_t j;
+
+    if (a->y > b->y || (a->y == b->y && a->x > b->x)) {
+      const mgos_ssd1306_point_t *t = a;
+      a = b;
+      b = t;
+    }
+    e.ya = a->y;
+    e.yb = b->y;
+    e.xa = (int32_t) a->x * 65536;
+    e.xb = (int32_t) b->x * 65536;
+    e.slope = (e.yb > e.ya) ? (int32_t) ((int64_t) (b->x - a->x) * 65536 / (2 * (e.yb - e.ya))) : 0;
+
+    j = ctx->num_edges++;
+    while (j > 0 && ctx->edges[j - 1].ya > e.ya) {
+      ctx->edges[j] = ctx->edges[j - 1];
+      --j;
+    }
+    ctx->edges[j] = e;
+
+    if (left > points[i].x)
+      left = points[i].x;
+    if (right < points[i].x)
+      right = points[i].x;
+    if (top > points[i].y)
+      top = points[i].y;
+    if (bottom < points[i].y)
+      bottom = points[i].y;
+  }
+
+  if (left < oled->clip_left)
+    left = oled->clip_left;
+  if (right > oled->clip_right)
+    right = oled->clip_right;
+  if (top < oled->clip_top)
+    top = oled->clip_top;
+  if (bottom > oled->clip_bottom)
+    bottom = oled->clip_bottom;
+  if (left > right || top > bottom)
+    return;
+
+  for (int16_t y = top; y <= bottom; ++y) {
+    uint16_t i, n;
+
+    // update the active edge table
+    while (next_edge < ctx->num_edges && ctx->edges[next_edge].ya <= y)
+      ctx->active[num_active++] = next_edge++;
+    for (i = 0, n = 0; i < num_active; ++i) {
+      if (ctx->edges[ctx->active[i]].yb >= y)
+        ctx->active[n++] = ctx->active[i];
+    }
+    num_active = n;
+
+    _scan_row (oled, ctx, num_active, y, y & 7);
+    if ((y & 7) == 7 || y == bottom)
+      _flush_page (oled, ctx, y / 8, color);
+  }
+
+  _mark_dirty (oled, left, top, right, bottom);
+}
+
+void mgos_ssd1306_fill_polygon (struct mgos_ssd1306 *oled, const mgos_ssd1306_point_t *points, uint16_t count,
+                                mgos_ssd1306_color_t color) {
+  mgos_ssd1306_point_t *aligned;
+  poly_ctx_t ctx;
+  uint8_t *mem;
+
+  if (oled == NULL || points == NULL || count == 0)
+    return;
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { color };
+    ssd1306_dl_record (oled, SSD1306_DL_POLYGON, args, points, count * sizeof (*points));
+    return;
+  }
+
+  mem = malloc (count * (sizeof (poly_edge_t) + sizeof (int32_t) + sizeof (uint16_t) +
+                         POLY_EVENTS_PER_VERTEX * sizeof (poly_event_t) + sizeof (*points)));
+  if (mem == NULL) {
+    LOG (LL_ERROR, ("Out of memory filling %d-point polygon", count));
+    return;
+  }
+  ctx.edges = (poly_edge_t *) mem;
+  ctx.cross = (int32_t *) (ctx.edges + count);
+  ctx.events = (poly_event_t *) (ctx.cross + count);
+  ctx.active = (uint16_t *) (ctx.events + count * POLY_EVENTS_PER_VERTEX);
+  aligned = (mgos_ssd1306_point_t *) (ctx.active + count);
+
+  // points may come unaligned from the mJS FFI
+  memcpy (aligned, points, count * sizeof (*points));
+  _fill_polygon (oled, &ctx, aligned, count, color);
+  free (mem);
+}
+
+void mgos_ssd1306_fill_triangle (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                                 int16_t x2, int16_t y2, mgos_ssd1306_color_t color) {
+  const mgos_ssd1306_point_t points[3] = { {x0, y0}, {x1, y1}, {x2, y2} };
+  poly_edge_t edges[3];
+  uint16_t active[3];
+  int32_t cross[3];
+  poly_event_t events[3 * POLY_EVENTS_PER_VERTEX];
+  poly_ctx_t ctx = {
+    .edges = edges,
+    .active = active,
+    .cross = cross,
+    .events = events,
+  };
+
+  if (oled == NULL)
+    return;
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x0, y0, x1, y1, x2, y2, color };
+    ssd1306_dl_record (oled, SSD1306_DL_TRIANGLE, args, NULL, 0);
+    return;
+  }
+
+  _fill_polygon (oled, &ctx, points, 3, color);
+}
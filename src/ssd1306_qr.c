@@ -0,0 +1,463 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * QR codes.
+ *
+ * Text is encoded in byte mode, in the smallest of versions 1 to 6 that holds it at
+ * the requested error correction level. Those versions need no version information
+ * and have at most one alignment pattern, so whether a module belongs to a function
+ * pattern is worked out from its position instead of being kept in a second matrix.
+ *
+ * All state lives on the stack: the codewords, at most 172 bytes, and the module
+ * matrix, one bit per module, at most 211 bytes. The data codewords are kept block
+ * after block with the error correction blocks behind them, and the interleaved
+ * order the symbol needs is computed while the modules are placed.
+ *
+ * Each of the eight masks is applied, scored with the penalty rules of the standard
+ * and removed again. The code is then written straight into the frame buffer, one
+ * byte per column and page, with dark modules off and light modules on.
+ */
+
+#include "ssd1306_internal.h"
+
+#define QR_MAX_VERSION 6
+#define QR_MAX_SIZE (17 + 4 * QR_MAX_VERSION)
+#define QR_MAX_CODEWORDS 172
+#define QR_QUIET 2              // quiet zone in modules
+
+// Codewords of each version, and error correction codewords per block and blocks by level
+static const uint8_t s_codewords[QR_MAX_VERSION] = { 26, 44, 70, 100, 134, 172 };
+
+static const uint8_t s_ecc_len[4][QR_MAX_VERSION] = {
+  {7, 10, 15, 20, 26, 18},
+  {10, 16, 26, 18, 24, 16},
+  {13, 22, 18, 26, 18, 24},
+  {17, 28, 22, 16, 22, 28},
+};
+
+static const uint8_t s_blocks[4][QR_MAX_VERSION] = {
+  {1, 1, 1, 1, 1, 2},
+  {1, 1, 1, 2, 2, 4},
+  {1, 1, 2, 2, 4, 4},
+  {1, 1, 2, 4, 4, 4},
+};
+
+// Level bits of the format information
+static const uint8_t s_format_level[4] = { 1, 0, 3, 2 };
+
+typedef struct {
+  uint8_t version;
+  uint8_t size;                 // modules per side
+  uint8_t blocks;
+  uint8_t ecc_len;              // error correction codewords per block
+  uint8_t short_data;           // data codewords of the short blocks, the rest have one more
+  uint8_t short_blocks;
+  uint8_t data;                 // data codewords
+  uint8_t total;                // all codewords
+  uint8_t codewords[QR_MAX_CODEWORDS];
+  uint8_t modules[(QR_MAX_SIZE * QR_MAX_SIZE + 7) / 8];
+} qr_t;
+
+// Pick the smallest version holding len bytes; false if none does
+static bool _layout (qr_t *qr, size_t len, mgos_ssd1306_qr_ecc_t ecc) {
+  for (uint8_t v = 1; v <= QR_MAX_VERSION; ++v) {
+    uint8_t total = s_codewords[v - 1], blocks = s_blocks[ecc][v - 1], ecc_len = s_ecc_len[ecc][v - 1];
+
+    // mode and 8 bit count take 12 bits
+    if (len + 2 > (size_t) (total - blocks * ecc_len))
+      continue;
+    qr->version = v;
+    qr->size = 17 + 4 * v;
+    qr->blocks = blocks;
+    qr->ecc_len = ecc_len;
+    qr->short_blocks = blocks - total % blocks;
+    qr->short_data = total / blocks - ecc_len;
+    qr->data = total - blocks * ecc_len;
+    qr->total = total;
+    return true;
+  }
+  return false;
+}
+
+static uint8_t _gf_mul (uint8_t x, uint8_t y) {
+  uint8_t z = 0;
+
+  for (int8_t i = 7; i >= 0; --i) {
+    z = (z << 1) ^ ((z >> 7) * 0x1d);
+    z ^= ((y >> i) & 1) * x;
+  }
+  return z;
+}
+
+// Data codewords, then the error correction codewords of every block
+static void _encode (qr_t *qr, const char *text, size_t len) {
+  uint8_t *cw = qr->codewords, generator[30];
+  uint16_t offset = 0;
+
+  memset (cw, 0, qr->total);
+  // byte mode and count, the bytes follow 4 bits off; the terminator and the padding
+  // to a byte are the zero bits after them
+  cw[0] = 0x40 | (len >> 4);
+  cw[1] = (len << 4);
+  for (size_t i = 0; i < len; ++i) {
+    cw[i + 1] |= (uint8_t) text[i] >> 4;
+    cw[i + 2] = (uint8_t) text[i] << 4;
+  }
+  for (uint16_t i = len + 2; i < qr->data; ++i)
+    cw[i] = ((i - len) & 1) ? 0x11 : 0xec;
+
+  // Reed-Solomon generator polynomial, leading term omitted
+  memset (generator, 0, qr->ecc_len);
+  generator[qr->ecc_len - 1] = 1;
+  for (uint8_t i = 0, root = 1; i < qr->ecc_len; ++i, root = _gf_mul (root, 0x02)) {
+    for (uint8_t j = 0; j < qr->ecc_len; ++j) {
+      generator[j] = _gf_mul (generator[j], root);
+      if (j + 1 < qr->ecc_len)
+        generator[j] ^= generator[j + 1];
+    }
+  }
+
+  // the remainder of each block, divided by the generator
+  for (uint8_t b = 0; b < qr->blocks; ++b) {
+    uint8_t *ecc = cw + qr->data + b * qr->ecc_len;
+    uint8_t n = qr->short_data + (b >= qr->short_blocks);
+
+    for (uint8_t i = 0; i < n; ++i) {
+      uint8_t factor = cw[offset + i] ^ ecc[0];
+
+      memmove (ecc, ecc + 1, qr->ecc_len - 1);
+      ecc[qr->ecc_len - 1] = 0;
+      for (uint8_t j = 0; j < qr->ecc_len; ++j)
+        ecc[j] ^= _gf_mul (generator[j], factor);
+    }
+    offset += n;
+  }
+}
+
+// Codeword k of the interleaved sequence: the blocks' data codewords in turn, the
+// long blocks' extra one last, then the error correction codewords in turn
+static uint8_t _interleaved (const qr_t *qr, uint16_t k) {
+  uint16_t block, i;
+
+  if (k >= qr->data) {
+    k -= qr->data;
+    return qr->codewords[qr->data + (k % qr->blocks) * qr->ecc_len + k / qr->blocks];
+  }
+  if (k < qr->short_data * qr->blocks) {
+    block = k % qr->blocks;
+    i = k / qr->blocks;
+  } else {
+    block = qr->short_blocks + k - qr->short_data * qr->blocks;
+    i = qr->short_data;
+  }
+  // short blocks first
+  return qr->codewords[block * qr->short_data + (block > qr->short_blocks ? block - qr->short_blocks : 0) + i];
+}
+
+static inline bool _get (const qr_t *qr, uint8_t x, uint8_t y) {
+  uint16_t i = (uint16_t) y * qr->size + x;
+
+  return (qr->modules[i >> 3] >> (i & 7)) & 1;
+}
+
+static inline void _set (qr_t *qr, uint8_t x, uint8_t y, bool dark) {
+  uint16_t i = (uint16_t) y * qr->size + x;
+
+  if (dark)
+    qr->modules[i >> 3] |= 1 << (i & 7);
+  else
+    qr->modules[i >> 3] &= ~(1 << (i & 7));
+}
+
+// Finder patterns with separators and format information, timing patterns and the alignment pattern
+static bool _is_function (const qr_t *qr, uint8_t x, uint8_t y) {
+  uint8_t far = qr->size - 8, align = qr->size - 7;
+
+  if ((x < 9 && y < 9) || (x < 9 && y >= far) || (x >= far && y < 9) || x == 6 || y == 6)
+    return true;
+  return qr->version > 1 && x + 2 >= align && x <= align + 2 && y + 2 >= align && y <= align + 2;
+}
+
+static void _draw_functions (qr_t *qr) {
+  uint8_t size = qr->size;
+  const uint8_t finders[3][2] = { {3, 3}, {size - 4, 3}, {3, size - 4} };
+
+  for (uint8_t i = 0; i < size; ++i) {
+    _set (qr, 6, i, !(i & 1));
+    _set (qr, i, 6, !(i & 1));
+  }
+  for (uint8_t f = 0; f < 3; ++f) {
+    for (int8_t dy = -4; dy <= 4; ++dy) {
+      for (int8_t dx = -4; dx <= 4; ++dx) {
+        int16_t x = finders[f][0] + dx, y = finders[f][1] + dy;
+        uint8_t dist = (abs (dx) > abs (dy)) ? abs (dx) : abs (dy);
+
+        if (x >= 0 && x < size && y >= 0 && y < size)
+          _set (qr, x, y, dist != 2 && dist != 4);
+      }
+    }
+  }
+  if (qr->version > 1) {
+    for (int8_t dy = -2; dy <= 2; ++dy) {
+      for (int8_t dx = -2; dx <= 2; ++dx)
+        _set (qr, size - 7 + dx, size - 7 + dy, abs (dx) == 2 || abs (dy) == 2 || (dx == 0 && dy == 0));
+    }
+  }
+}
+
+// Both copies of the format information, and the dark module
+static void _draw_format (qr_t *qr, mgos_ssd1306_qr_ecc_t ecc, uint8_t mask) {
+  uint16_t data = s_format_level[ecc] << 3 | mask, rem = data, bits;
+  uint8_t size = qr->size;
+
+  for (uint8_t i = 0; i < 10; ++i)
+    rem = (rem << 1) ^ ((rem >> 9) * 0x537);
+  bits = ((data << 10) | (rem & 0x3ff)) ^ 0x5412;
+
+  for (uint8_t i = 0; i < 6; ++i)
+    _set (qr, 8, i, (bits >> i) & 1);
+  _set (qr, 8, 7, (bits >> 6) & 1);
+  _set (qr, 8, 8, (bits >> 7) & 1);
+  _set (qr, 7, 8, (bits >> 8) & 1);
+  for (uint8_t i = 9; i < 15; ++i)
+    _set (qr, 14 - i, 8, (bits >> i) & 1);
+  for (uint8_t i = 0; i < 8; ++i)
+    _set (qr, size - 1 - i, 8, (bits >> i) & 1);
+  for (uint8_t i = 8; i < 15; ++i)
+    _set (qr, 8, size - 15 + i, (bits >> i) & 1);
+  _set (qr, 8, size - 8, true);
+}
+
+// Place the interleaved codewords in two column wide zigzags from the bottom right;
+// the remainder bits are left light
+static void _draw_codewords (qr_t *qr) {
+  uint16_t bit = 0, bits = qr->total * 8;
+  uint8_t byte = 0;
+
+  for (int16_t right = qr->size - 1; right >= 1; right -= 2) {
+    // the vertical timing pattern takes a whole column
+    if (right == 6)
+      right = 5;
+    for (uint8_t vert = 0; vert < qr->size; ++vert) {
+      uint8_t y = ((right + 1) & 2) ? vert : qr->size - 1 - vert;
+
+      for (uint8_t j = 0; j < 2; ++j) {
+        uint8_t x = right - j;
+
+        if (_is_function (qr, x, y) || bit >= bits)
+          continue;
+        if ((bit & 7) == 0)
+          byte = _interleaved (qr, bit >> 3);
+        _set (qr, x, y, (byte << (bit & 7)) & 0x80);
+        bit++;
+      }
+    }
+  }
+}
+
+static bool _mask_bit (uint8_t mask, uint8_t x, uint8_t y) {
+  switch (mask) {
+  case 0:
+    return (x + y) % 2 == 0;
+  case 1:
+    return y % 2 == 0;
+  case 2:
+    return x % 3 == 0;
+  case 3:
+    return (x + y) % 3 == 0;
+  case 4:
+    return (x / 3 + y / 2) % 2 == 0;
+  case 5:
+    return x * y % 2 + x * y % 3 == 0;
+  case 6:
+    return (x * y % 2 + x * y % 3) % 2 == 0;
+  default:
+    return ((x + y) % 2 + x * y % 3) % 2 == 0;
+  }
+}
+
+// Masks are their own inverse
+static void _apply_mask_pattern (qr_t *qr, uint8_t mask) {
+  for (uint8_t y = 0; y < qr->size; ++y) {
+    for (uint8_t x = 0; x < qr->size; ++x) {
+      if (!_is_function (qr, x, y) && _mask_bit (mask, x, y))
+        _set (qr, x, y, !_get (qr, x, y));
+    }
+  }
+}
+
+// Module along a row, or along a column when transposed
+static inline bool _line_get (const qr_t *qr, bool transposed, uint8_t line, uint8_t i) {
+  return transposed ? _get (qr, line, i) : _get (qr, i, line);
+}
+
+static uint32_t _penalty (const qr_t *qr) {
+  uint8_t size = qr->size;
+  uint32_t penalty = 0, dark = 0, total, diff;
+
+  for (uint8_t t = 0; t < 2; ++t) {
+    for (uint8_t line = 0; line < size; ++line) {
+      uint16_t window = 0;
+      uint8_t run = 0;
+      bool color = false;
+
+      for (uint8_t i = 0; i < size + 4; ++i) {
+        // the quiet zone is light
+        bool c = (i < size) && _line_get (qr, t, line, i);
+
+        // runs of five or more of a color
+        if (i < size) {
+          if (i > 0 && c == color) {
+            if (++run == 5)
+              penalty += 3;
+            else if (run > 5)
+              penalty++;
+          } else {
+            color = c;
+            run = 1;
+          }
+        }
+        // finder-like 1:1:3:1:1 with four light modules on either side
+        window = ((window << 1) | c) & 0x7ff;
+        if (window == 0x5d || window == 0x5d0)
+          penalty += 40;
+      }
+    }
+  }
+
+  for (uint8_t y = 0; y < size; ++y) {
+    for (uint8_t x = 0; x < size; ++x) {
+      bool c = _get (qr, x, y);
+
+      dark += c;
+      // 2x2 blocks of a color
+      if (x + 1 < size && y + 1 < size && c == _get (qr, x + 1, y) && c == _get (qr, x, y + 1) && c == _get (qr, x + 1, y + 1))
+        penalty += 3;
+    }
+  }
+
+  // 10 for every full 5% the dark modules are away from half, beyond the first; an
+  // odd size never has exactly half
+  total = (uint32_t) size * size;
+  diff = (dark * 20 > total * 10) ? dark * 20 - total * 10 : total * 10 - dark * 20;
+  penalty += ((diff + total - 1) / total - 1) * 10;
+  return penalty;
+}
+
+// Encode text into the module matrix with the mask of the lowest penalty
+static bool _make (qr_t *qr, const char *text, mgos_ssd1306_qr_ecc_t ecc) {
+  size_t len = strlen (text);
+  uint32_t best = UINT32_MAX;
+  uint8_t best_mask = 0;
+
+  if ((unsigned) ecc > SSD1306_QR_ECC_HIGH || !_layout (qr, len, ecc))
+    return false;
+  _encode (qr, text, len);
+  memset (qr->modules, 0, sizeof (qr->modules));
+  _draw_functions (qr);
+  _draw_codewords (qr);
+  for (uint8_t mask = 0; mask < 8; ++mask) {
+    uint32_t penalty;
+
+    _apply_mask_pattern (qr, mask);
+    _draw_format (qr, ecc, mask);
+    penalty = _penalty (qr);
+    if (penalty < best) {
+      best = penalty;
+      best_mask = mask;
+    }
+    _apply_mask_pattern (qr, mask);
+  }
+  _apply_mask_pattern (qr, best_mask);
+  _draw_format (qr, ecc, best_mask);
+  return true;
+}
+
+uint16_t mgos_ssd1306_measure_qr (const char *text, mgos_ssd1306_qr_ecc_t ecc, uint8_t scale) {
+  qr_t qr;
+
+  if (text == NULL || (unsigned) ecc > SSD1306_QR_ECC_HIGH || !_layout (&qr, strlen (text), ecc))
+    return 0;
+  return (qr.size + 2 * QR_QUIET) * scale;
+}
+
+uint16_t mgos_ssd1306_draw_qr (struct mgos_ssd1306 *oled, int16_t x, int16_t y, const char *text, uint8_t scale,
+                               mgos_ssd1306_qr_ecc_t ecc) {
+  qr_t qr;
+  int32_t side, left, top, right, bottom;
+
+  if (oled == NULL || text == NULL || scale == 0)
+    return 0;
+  if (oled->dlist != NULL) {
+    LOG (LL_ERROR, ("SSD1306 QR codes need a frame buffer and cannot be recorded in a display list"));
+    return 0;
+  }
+  if (!_make (&qr, text, ecc)) {
+    LOG (LL_ERROR, ("SSD1306 QR code of %d bytes does not fit version %d", (int) strlen (text), QR_MAX_VERSION));
+    return 0;
+  }
+
+  side = (qr.size + 2 * QR_QUIET) * scale;
+  left = (x > oled->clip_left) ? x : oled->clip_left;
+  top = (y > oled->clip_top) ? y : oled->clip_top;
+  right = (x + side - 1 < oled->clip_right) ? x + side - 1 : oled->clip_right;
+  bottom = (y + side - 1 < oled->clip_bottom) ? y + side - 1 : oled->clip_bottom;
+  if (left > right || top > bottom)
+    return side;
+
+  // one byte per column and page: the module row of each bit is fixed for the page,
+  // and the module column advances every scale columns
+  for (int32_t page = top / 8; page <= bottom / 8; ++page) {
+    int16_t rows[8];
+    uint8_t mask = 0xff, *dst = oled->buffer + page * oled->canvas_width;
+    int16_t col = (left - x) / scale - QR_QUIET;
+    uint8_t step = (left - x) % scale;
+
+    if (page * 8 < top)
+      mask &= 0xff << (top - page * 8);
+    if (page * 8 + 7 > bottom)
+      mask &= 0xff >> (page * 8 + 7 - bottom);
+    for (uint8_t b = 0; b < 8; ++b)
+      rows[b] = (page * 8 + b - y >= 0) ? (page * 8 + b - y) / scale - QR_QUIET : -1;
+
+    for (int32_t cx = left; cx <= right; ++cx) {
+      uint8_t bits = 0xff;
+
+      if (col >= 0 && col < qr.size) {
+        for (uint8_t b = 0; b < 8; ++b) {
+          if (rows[b] >= 0 && rows[b] < qr.size && _get (&qr, col, rows[b]))
+            bits &= ~(1 << b);
+        }
+      }
+      dst[cx] = (dst[cx] & ~mask) | (bits & mask);
+      if (++step == scale) {
+        step = 0;
+        col++;
+      }
+    }
+  }
+  _mark_dirty (oled, left, top, right, bottom);
+  return side;
+}
@@ -0,0 +1,123 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Word-at-a-time raster kernels.
+ *
+ * Frame buffers, layers and offscreen canvases start on a word boundary, and the
+ * page rows they are made of are runs of consecutive bytes. The kernels work a
+ * byte at a time up to the first word boundary, then on 32-bit words, then on the
+ * remaining bytes. A byte mask is spread to all 4 bytes of a word, so a fill or an
+ * invert of a region is 4 columns per operation. Two buffers can only be walked by
+ * words together when they have the same alignment; otherwise the kernels fall
+ * back to bytes.
+ */
+
+#include "ssd1306_internal.h"
+
+static inline bool _aligned (const void *p) {
+  return ((uintptr_t) p & 3) == 0;
+}
+
+void ssd1306_fill_bytes (uint8_t *dst, uint16_t n, uint8_t mask, mgos_ssd1306_color_t color) {
+  uint32_t word = mask * 0x01010101u;
+  ssd1306_word_t *w;
+
+  if (color != SSD1306_COLOR_WHITE && color != SSD1306_COLOR_BLACK && color != SSD1306_COLOR_INVERT)
+    return;
+
+  for (; n && !_aligned (dst); --n, ++dst)
+    _apply_mask (dst, mask, color);
+  w = (ssd1306_word_t *) dst;
+  switch (color) {
+  case SSD1306_COLOR_WHITE:
+    if (mask == 0xff)
+      for (; n >= 4; n -= 4)
+        *w++ = word;
+    else
+      for (; n >= 4; n -= 4)
+        *w++ |= word;
+    break;
+  case SSD1306_COLOR_BLACK:
+    if (mask == 0xff)
+      for (; n >= 4; n -= 4)
+        *w++ = 0;
+    else
+      for (; n >= 4; n -= 4)
+        *w++ &= ~word;
+    break;
+  default:
+    for (; n >= 4; n -= 4)
+      *w++ ^= word;
+    break;
+  }
+  for (dst = (uint8_t *) w; n; --n, ++dst)
+    _apply_mask (dst, mask, color);
+}
+
+void ssd1306_copy_bytes (uint8_t *dst, const uint8_t *src, uint16_t n) {
+  if (((uintptr_t) dst & 3) == ((uintptr_t) src & 3)) {
+    const ssd1306_word_t *s;
+    ssd1306_word_t *d;
+
+    for (; n && !_aligned (dst); --n)
+      *dst++ = *src++;
+    for (d = (ssd1306_word_t *) dst, s = (const ssd1306_word_t *) src; n >= 4; n -= 4)
+      *d++ = *s++;
+    dst = (uint8_t *) d;
+    src = (const uint8_t *) s;
+  }
+  while (n--)
+    *dst++ = *src++;
+}
+
+bool ssd1306_diff_bytes (const uint8_t *a, const uint8_t *b, uint16_t n, uint16_t *first, uint16_t *last) {
+  bool words = ((uintptr_t) a & 3) == ((uintptr_t) b & 3);
+  uint16_t lo = 0, hi = n;
+
+  // forward to the first difference
+  for (; lo < n && (!words || !_aligned (a + lo)); ++lo)
+    if (a[lo] != b[lo])
+      break;
+  if (lo < n && a[lo] == b[lo]) {
+    for (; lo + 4 <= n && *(const ssd1306_word_t *) (a + lo) == *(const ssd1306_word_t *) (b + lo); lo += 4);
+    for (; lo < n && a[lo] == b[lo]; ++lo);
+  }
+  if (lo == n)
+    return false;
+
+  // back to the last one, which is at lo or after it
+  for (; hi > lo + 1 && (!words || !_aligned (a + hi)); --hi)
+    if (a[hi - 1] != b[hi - 1])
+      break;
+  if (a[hi - 1] == b[hi - 1]) {
+    for (; hi >= lo + 5 && *(const ssd1306_word_t *) (a + hi - 4) == *(const ssd1306_word_t *) (b + hi - 4); hi -= 4);
+    for (; a[hi - 1] == b[hi - 1]; --hi);
+  }
+  if (first != NULL)
+    *first = lo;
+  if (last != NULL)
+    *last = hi - 1;
+  return true;
+}
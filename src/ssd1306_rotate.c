@@ -0,0 +1,162 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Software rotation by 90 and 270 degrees (portrait mode).
+ *
+ * The canvas is drawn as usual, in the rotated orientation: its width is the panel
+ * height. On refresh, the dirty window is mapped to panel pages. Each panel page is
+ * built in the scratch page from 8x8 pixel blocks, and each block comes from 8
+ * consecutive canvas bytes. Those bytes are 8 canvas columns of one canvas page,
+ * and they become 8 panel columns of one panel page once the bit matrix is
+ * transposed. The transpose is done SWAR-style on two 32-bit words, in 3 steps of
+ * masked swaps, instead of 64 single-pixel moves.
+ *
+ * Canvas pixel (x, y) is shown at panel pixel (width - 1 - y, x) at 90 degrees, and
+ * at (y, height - 1 - x) at 270 degrees.
+ */
+
+#include "ssd1306_internal.h"
+
+// Transpose an 8x8 bit matrix: on input, bit j of byte i of lo:hi (bytes 0-3 in lo,
+// 4-7 in hi) is row i, column j; on output it is row j, column i.
+static inline void _transpose8 (uint32_t *lo, uint32_t *hi) {
+  uint32_t a = *lo, b = *hi, t;
+
+  // swap the off-diagonal bits of 2x2 blocks, then 2x2 blocks of 4x4 blocks...
+  t = (a ^ (a >> 7)) & 0x00aa00aa;
+  a ^= t ^ (t << 7);
+  t = (b ^ (b >> 7)) & 0x00aa00aa;
+  b ^= t ^ (t << 7);
+  t = (a ^ (a >> 14)) & 0x0000cccc;
+  a ^= t ^ (t << 14);
+  t = (b ^ (b >> 14)) & 0x0000cccc;
+  b ^= t ^ (t << 14);
+  // ...then the 4x4 blocks, across the two words
+  t = (a ^ (b << 4)) & 0xf0f0f0f0;
+  a ^= t;
+  b ^= t >> 4;
+  *lo = a;
+  *hi = b;
+}
+
+// Transpose the 8 canvas bytes at src into 8 panel bytes at dst, dst + step, ...;
+// reverse takes the canvas bytes last to first
+static inline void _block (const uint8_t *src, bool reverse, uint8_t *dst, int8_t step) {
+  uint32_t lo, hi;
+
+  if (reverse) {
+    lo = src[7] | (src[6] << 8) | (src[5] << 16) | ((uint32_t) src[4] << 24);
+    hi = src[3] | (src[2] << 8) | (src[1] << 16) | ((uint32_t) src[0] << 24);
+  } else {
+    lo = src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t) src[3] << 24);
+    hi = src[4] | (src[5] << 8) | (src[6] << 16) | ((uint32_t) src[7] << 24);
+  }
+  if (lo | hi)
+    _transpose8 (&lo, &hi);
+  for (uint8_t i = 0; i < 4; ++i, dst += step, lo >>= 8)
+    *dst = lo;
+  for (uint8_t i = 0; i < 4; ++i, dst += step, hi >>= 8)
+    *dst = hi;
+}
+
+void ssd1306_rotate_refresh (struct mgos_ssd1306 *oled, bool force) {
+  int16_t left = 0, top = 0, right = oled->canvas_width - 1, bottom = oled->canvas_height - 1;
+  uint16_t page_start, page_end, col_start, col_end;
+  uint8_t *buffer = oled->buffer;
+
+  if (!force) {
+    if (oled->refresh_left > left)
+      left = oled->refresh_left;
+    if (oled->refresh_top > top)
+      top = oled->refresh_top;
+    if (oled->refresh_right < right)
+      right = oled->refresh_right;
+    if (oled->refresh_bottom < bottom)
+      bottom = oled->refresh_bottom;
+    if (left > right || top > bottom)
+      return;
+  }
+  if (oled->layers != NULL) {
+    ssd1306_layers_composite (oled, left, top / 8, right, bottom / 8);
+    oled->buffer = oled->composite;
+  }
+
+  // canvas columns are panel rows, canvas rows are panel columns
+  if (oled->rotation == 90) {
+    page_start = left / 8;
+    page_end = right / 8;
+    col_start = oled->width - 1 - bottom;
+    col_end = oled->width - 1 - top;
+  } else {
+    page_start = (oled->height - 1 - right) / 8;
+    page_end = (oled->height - 1 - left) / 8;
+    col_start = top;
+    col_end = bottom;
+  }
+  for (uint16_t page = page_start; page <= page_end; ++page) {
+    // the canvas columns shown on this panel page
+    const uint8_t *src = oled->buffer + 8 * ((oled->rotation == 90) ? page : oled->height / 8 - 1 - page);
+
+    for (uint16_t canvas_page = top / 8; canvas_page <= bottom / 8; ++canvas_page) {
+      if (oled->rotation == 90)
+        _block (src + canvas_page * oled->canvas_width, false, oled->line + oled->width - 1 - canvas_page * 8, -1);
+      else
+        _block (src + canvas_page * oled->canvas_width, true, oled->line + canvas_page * 8, 1);
+    }
+    ssd1306_write_page (oled, page, col_start, col_end - col_start + 1, oled->line + col_start);
+  }
+  oled->buffer = buffer;
+}
+
+bool mgos_ssd1306_set_rotation (struct mgos_ssd1306 *oled, uint16_t rotation) {
+  if (oled == NULL)
+    return false;
+  if (rotation != 0 && rotation != 90 && rotation != 270) {
+    LOG (LL_ERROR, ("SSD1306 rotation must be 0, 90 or 270 degrees"));
+    return false;
+  }
+  if (rotation == oled->rotation)
+    return true;
+  if (oled->frame != NULL || oled->gray != NULL || oled->layers != NULL || oled->target != NULL || oled->width % 8 != 0 ||
+      (uint32_t) oled->canvas_width * oled->canvas_height != (uint32_t) oled->width * oled->height) {
+    LOG (LL_ERROR, ("SSD1306 rotation needs a frame buffer the size of the panel, without layers, gray or offscreen canvas"));
+    return false;
+  }
+
+  oled->rotation = rotation;
+  oled->canvas_width = rotation ? oled->height : oled->width;
+  oled->canvas_height = rotation ? oled->width : oled->height;
+  oled->view_x = 0;
+  oled->view_y = 0;
+  _reset_clip (oled);
+  ssd1306_fill_bytes (oled->buffer, oled->canvas_width * oled->canvas_height / 8, 0xff, SSD1306_COLOR_BLACK);
+  _reset_dirty (oled);
+  _mark_dirty (oled, 0, 0, oled->canvas_width - 1, oled->canvas_height - 1);
+  return true;
+}
+
+uint16_t mgos_ssd1306_get_rotation (struct mgos_ssd1306 *oled) {
+  return (oled != NULL) ? oled->rotation : 0;
+}
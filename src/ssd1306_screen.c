@@ -0,0 +1,249 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Cached screens.
+ *
+ * A screen is a copy of the canvas taken once its static parts are drawn, kept under
+ * a name in memory or in a file. Showing it copies the image back into the canvas,
+ * lets the application draw the fields that change, and then compares the result a
+ * page row at a time with a copy of the canvas as it was, which is what the panel
+ * shows apart from the dirty window. Runs of changed bytes, with short gaps between
+ * them merged, are sent straight to the panel; switching between screens that share
+ * their layout sends only what differs.
+ *
+ * With layers or in portrait mode the panel does not show the canvas bytes as they
+ * are, so the changes are marked dirty and sent by a refresh instead.
+ */
+
+#include <stdio.h>
+
+#include "ssd1306_internal.h"
+
+#define SCREEN_GAP 16           // unchanged bytes cheaper to send than a new column window
+
+struct mgos_ssd1306_screen {
+  struct mgos_ssd1306_screen *next;
+  char *path;                   // file holding the image, NULL when kept in memory
+  uint8_t *pixels;              // image in memory
+  char name[];
+};
+
+static struct mgos_ssd1306_screen *_find (struct mgos_ssd1306 *oled, const char *name) {
+  for (struct mgos_ssd1306_screen *s = oled->screens; s != NULL; s = s->next) {
+    if (strcmp (s->name, name) == 0)
+      return s;
+  }
+  return NULL;
+}
+
+// Screens are images of the driver canvas, which needs to be in use
+static bool _usable (struct mgos_ssd1306 *oled) {
+  if (oled->dlist != NULL || oled->gray != NULL || oled->target != NULL) {
+    LOG (LL_ERROR, ("SSD1306 screens need the frame buffer selected and no display list"));
+    return false;
+  }
+  return true;
+}
+
+static void _free (struct mgos_ssd1306_screen *s) {
+  free (s->path);
+  free (s->pixels);
+  free (s);
+}
+
+bool mgos_ssd1306_screen_store (struct mgos_ssd1306 *oled, const char *name, const char *path) {
+  uint32_t size;
+  struct mgos_ssd1306_screen *s, **p;
+
+  if (oled == NULL || name == NULL || !_usable (oled))
+    return false;
+
+  size = (uint32_t) oled->canvas_width * oled->canvas_height / 8;
+  if ((s = calloc (1, sizeof (*s) + strlen (name) + 1)) == NULL)
+    goto out_mem;
+  strcpy (s->name, name);
+  if (path != NULL) {
+    FILE *fp;
+    bool ok;
+
+    if ((s->path = strdup (path)) == NULL)
+      goto out_mem;
+    if ((fp = fopen (path, "wb")) == NULL) {
+      LOG (LL_ERROR, ("SSD1306 cannot write screen %s to %s", name, path));
+      _free (s);
+      return false;
+    }
+    ok = fwrite (_canvas (oled), 1, size, fp) == size;
+    if (fclose (fp) != 0 || !ok) {
+      LOG (LL_ERROR, ("SSD1306 cannot write screen %s to %s", name, path));
+      _free (s);
+      return false;
+    }
+  } else {
+    if ((s->pixels = malloc (size)) == NULL)
+      goto out_mem;
+    ssd1306_copy_bytes (s->pixels, _canvas (oled), size);
+  }
+
+  // a screen stored again replaces the old image
+  for (p = &oled->screens; *p != NULL; p = &(*p)->next) {
+    if (strcmp ((*p)->name, name) == 0) {
+      struct mgos_ssd1306_screen *old = *p;
+
+      *p = old->next;
+      _free (old);
+      break;
+    }
+  }
+  s->next = oled->screens;
+  oled->screens = s;
+  return true;
+
+out_mem:
+  LOG (LL_ERROR, ("SSD1306 out of memory storing screen %s", name));
+  if (s != NULL)
+    _free (s);
+  return false;
+}
+
+void mgos_ssd1306_screen_drop (struct mgos_ssd1306 *oled, const char *name) {
+  if (oled == NULL || name == NULL)
+    return;
+
+  for (struct mgos_ssd1306_screen **p = &oled->screens; *p != NULL; p = &(*p)->next) {
+    if (strcmp ((*p)->name, name) == 0) {
+      struct mgos_ssd1306_screen *s = *p;
+
+      *p = s->next;
+      _free (s);
+      return;
+    }
+  }
+}
+
+void ssd1306_screens_free (struct mgos_ssd1306 *oled) {
+  while (oled->screens != NULL) {
+    struct mgos_ssd1306_screen *s = oled->screens;
+
+    oled->screens = s->next;
+    _free (s);
+  }
+}
+
+// Copy a screen's image into the canvas
+static bool _load (struct mgos_ssd1306 *oled, const struct mgos_ssd1306_screen *s, uint32_t size) {
+  FILE *fp;
+  bool ok;
+
+  if (s->path == NULL) {
+    ssd1306_copy_bytes (_canvas (oled), s->pixels, size);
+    return true;
+  }
+  if ((fp = fopen (s->path, "rb")) == NULL)
+    return false;
+  ok = fread (_canvas (oled), 1, size, fp) == size;
+  fclose (fp);
+  return ok;
+}
+
+// Send the columns of canvas page page that differ from the old canvas, or lie in
+// the dirty window, in runs, limited to the viewport
+static void _send_page (struct mgos_ssd1306 *oled, const uint8_t *old, uint16_t page) {
+  const uint8_t *cur = _canvas (oled) + page * oled->canvas_width + oled->view_x;
+  int32_t forced_left = INT32_MAX, forced_right = -1, run_left = -1, run_right = -1;
+  uint16_t first, last;
+
+  old += page * oled->canvas_width + oled->view_x;
+  if (oled->refresh_top <= page * 8 + 7 && oled->refresh_bottom >= page * 8) {
+    forced_left = oled->refresh_left - oled->view_x;
+    forced_right = oled->refresh_right - oled->view_x;
+  }
+  if (!ssd1306_diff_bytes (cur, old, oled->width, &first, &last)) {
+    first = oled->width;
+    last = 0;
+  }
+  if (forced_left < first)
+    first = (forced_left < 0) ? 0 : forced_left;
+  if (forced_right > last)
+    last = (forced_right >= oled->width) ? oled->width - 1 : forced_right;
+
+  for (int32_t col = first; col <= last; ++col) {
+    if (cur[col] == old[col] && (col < forced_left || col > forced_right))
+      continue;
+    if (run_left >= 0 && col - run_right > SCREEN_GAP) {
+      ssd1306_write_page (oled, page - oled->view_y / 8, run_left, run_right - run_left + 1, cur + run_left);
+      run_left = -1;
+    }
+    if (run_left < 0)
+      run_left = col;
+    run_right = col;
+  }
+  if (run_left >= 0)
+    ssd1306_write_page (oled, page - oled->view_y / 8, run_left, run_right - run_left + 1, cur + run_left);
+}
+
+bool mgos_ssd1306_screen_show (struct mgos_ssd1306 *oled, const char *name, mgos_ssd1306_screen_cb_t cb, void *arg) {
+  struct mgos_ssd1306_screen *s;
+  uint32_t size;
+  uint8_t *old;
+
+  if (oled == NULL || name == NULL || !_usable (oled))
+    return false;
+  if ((s = _find (oled, name)) == NULL)
+    return false;
+
+  size = (uint32_t) oled->canvas_width * oled->canvas_height / 8;
+  if ((old = malloc (size)) == NULL) {
+    LOG (LL_ERROR, ("SSD1306 out of memory showing screen %s", name));
+    return false;
+  }
+  ssd1306_copy_bytes (old, _canvas (oled), size);
+  if (!_load (oled, s, size)) {
+    LOG (LL_ERROR, ("SSD1306 cannot read screen %s from %s", name, s->path));
+    ssd1306_copy_bytes (_canvas (oled), old, size);
+    free (old);
+    return false;
+  }
+  if (cb != NULL)
+    cb (oled, arg);
+
+  if (oled->layers != NULL || oled->rotation || (oled->view_y & 7)) {
+    // the changed span of each page row, sent by refresh
+    for (uint16_t page = 0; page < oled->canvas_height / 8; ++page) {
+      uint16_t first, last;
+
+      if (ssd1306_diff_bytes (_canvas (oled) + page * oled->canvas_width, old + page * oled->canvas_width, oled->canvas_width,
+                              &first, &last))
+        _mark_dirty (oled, first, page * 8, last, page * 8 + 7);
+    }
+    mgos_ssd1306_refresh (oled, false);
+  } else {
+    for (uint16_t page = oled->view_y / 8; page < (oled->view_y + oled->height) / 8; ++page)
+      _send_page (oled, old, page);
+    _reset_dirty (oled);
+  }
+  free (old);
+  return true;
+}
@@ -0,0 +1,417 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+/*
+ * Column span shape rasterizer.
+ *
+ * Every shape is described by the rows it covers in each column. Each column is
+ * written once with the vertical span writer (premask, whole bytes, postmask), so
+ * no pixel is ever drawn twice and SSD1306_COLOR_INVERT works without special cases.
+ * Outlines are derived from the same column extents: a pixel is on the outline when
+ * it is at the end of its column or next to a row the neighbouring column lacks.
+ */
+
+#include "ssd1306_internal.h"
+
+typedef struct {
+  int16_t top;
+  int16_t bottom;               // top > bottom for an empty column
+} shape_col_t;
+
+typedef void (*shape_col_fn) (const void *shape, int16_t x, shape_col_t *col);
+
+typedef struct {
+  int16_t x0, y0;               // center
+  uint16_t rx, ry;              // radii
+} shape_ellipse_t;
+
+typedef struct {
+  int16_t x, y;                 // top left corner
+  uint16_t w, h;
+  uint16_t r;                   // corner radius
+} shape_round_rect_t;
+
+static uint16_t _isqrt (uint32_t v) {
+  uint32_t root = 0, bit = 1UL << 30;
+
+  while (bit > v)
+    bit >>= 2;
+  while (bit) {
+    if (v >= root + bit) {
+      v -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+// Half height of an ellipse column dx away from the center. Pixels are inside when
+// dx^2 * ry^2 + dy^2 * rx^2 <= rx^2 * ry^2 + rx * ry * min(rx, ry), that is
+// dx^2/rx^2 + dy^2/ry^2 <= 1 + 1/max(rx, ry). The slack keeps the poles and the
+// equator one pixel wide; for a circle the rule reduces to dx^2 + dy^2 <= r^2 + r.
+static int16_t _ellipse_height (uint16_t rx, uint16_t ry, uint16_t dx) {
+  uint64_t rx2 = (uint64_t) rx * rx;
+  uint64_t limit = rx2 * ry * ry + (uint64_t) rx * ry * ((rx < ry) ? rx : ry);
+  uint64_t used = (uint64_t) dx * dx * ry * ry;
+
+  if (used > limit)
+    return -1;
+  return _isqrt ((uint32_t) ((limit - used) / rx2));
+}
+
+static void _ellipse_col (const void *shape, int16_t x, shape_col_t *col) {
+  const shape_ellipse_t *e = (const shape_ellipse_t *) shape;
+  int16_t h = _ellipse_height (e->rx, e->ry, abs (x - e->x0));
+
+  col->top = e->y0 - h;
+  col->bottom = e->y0 + h;
+}
+
+static void _round_rect_col (const void *shape, int16_t x, shape_col_t *col) {
+  const shape_round_rect_t *rr = (const shape_round_rect_t *) shape;
+  int16_t dx = 0;
+
+  // distance into the corner, measured from the corner circle's center column
+  if (x < rr->x + rr->r)
+    dx = rr->x + rr->r - x;
+  else if (x > rr->x + rr->w - 1 - rr->r)
+    dx = x - (rr->x + rr->w - 1 - rr->r);
+
+  col->top = rr->y;
+  col->bottom = rr->y + rr->h - 1;
+  if (dx) {
+    int16_t inset = rr->r - _ellipse_height (rr->r, rr->r, dx);
+    col->top += inset;
+    col->bottom -= inset;
+  }
+}
+
+// Write rows top..bottom of column x, clipped to the clip rectangle
+static void _col_span (struct mgos_ssd1306 *oled, int16_t x, int16_t top, int16_t bottom, mgos_ssd1306_color_t color) {
+  if (top < oled->clip_top)
+    top = oled->clip_top;
+  if (bottom > oled->clip_bottom)
+    bottom = oled->clip_bottom;
+  if (top <= bottom)
+    ssd1306_vline (oled, x, top, bottom - top + 1, color);
+}
+
+static void _fill_shape (struct mgos_ssd1306 *oled, int16_t left, int16_t right, shape_col_fn fn, const void *shape,
+                         mgos_ssd1306_color_t color) {
+  shape_col_t col;
+
+  if (left < oled->clip_left)
+    left = oled->clip_left;
+  if (right > oled->clip_right)
+    right = oled->clip_right;
+  for (int16_t x = left; x <= right; ++x) {
+    fn (shape, x, &col);
+    _col_span (oled, x, col.top, col.bottom, color);
+  }
+}
+
+static void _outline_shape (struct mgos_ssd1306 *oled, int16_t left, int16_t right, shape_col_fn fn, const void *shape,
+                            mgos_ssd1306_color_t color) {
+  static const shape_col_t empty = { 1, 0 };
+  shape_col_t prev, cur, next;
+  int16_t first = (left < oled->clip_left) ? oled->clip_left : left;
+  int16_t last = (right > oled->clip_right) ? oled->clip_right : right;
+
+  if (first > last)
+    return;
+
+  if (first > left)
+    fn (shape, first - 1, &prev);
+  else
+    prev = empty;
+  fn (shape, first, &cur);
+  for (int16_t x = first; x <= last; ++x) {
+    if (x < right)
+      fn (shape, x + 1, &next);
+    else
+      next = empty;
+
+    if (cur.top <= cur.bottom) {
+      if (prev.top > prev.bottom || next.top > next.bottom) {
+        _col_span (oled, x, cur.top, cur.bottom, color);
+      } else {
+        // rows up to the neighbours' tops and from their bottoms belong to the outline
+        int16_t top_end = ((prev.top > next.top) ? prev.top : next.top) - 1;
+        int16_t bottom_start = ((prev.bottom < next.bottom) ? prev.bottom : next.bottom) + 1;
+
+        if (top_end < cur.top)
+          top_end = cur.top;
+        if (bottom_start > cur.bottom)
+          bottom_start = cur.bottom;
+        if (top_end + 1 >= bottom_start) {
+          _col_span (oled, x, cur.top, cur.bottom, color);
+        } else {
+          _col_span (oled, x, cur.top, top_end, color);
+          _col_span (oled, x, bottom_start, cur.bottom, color);
+        }
+      }
+    }
+    prev = cur;
+    cur = next;
+  }
+}
+
+static void _ellipse (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, uint16_t rx, uint16_t ry, bool fill,
+                      mgos_ssd1306_color_t color) {
+  const shape_ellipse_t e = { x0, y0, rx, ry };
+
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x0, y0, rx, ry, color };
+    ssd1306_dl_record (oled, fill ? SSD1306_DL_FILL_ELLIPSE : SSD1306_DL_ELLIPSE, args, NULL, 0);
+    return;
+  }
+  if (rx == 0 || ry == 0) {
+    // degenerate ellipses are lines; outline and fill are the same
+    mgos_ssd1306_fill_rectangle (oled, x0 - rx, y0 - ry, 2 * rx + 1, 2 * ry + 1, color);
+    return;
+  }
+
+  if (fill)
+    _fill_shape (oled, x0 - rx, x0 + rx, _ellipse_col, &e, color);
+  else
+    _outline_shape (oled, x0 - rx, x0 + rx, _ellipse_col, &e, color);
+  _mark_dirty_clipped (oled, x0 - rx, y0 - ry, x0 + rx, y0 + ry);
+}
+
+void mgos_ssd1306_draw_ellipse (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, uint16_t rx, uint16_t ry,
+                                mgos_ssd1306_color_t color) {
+  if (oled == NULL)
+    return;
+
+  _ellipse (oled, x0, y0, rx, ry, false, color);
+}
+
+void mgos_ssd1306_fill_ellipse (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, uint16_t rx, uint16_t ry,
+                                mgos_ssd1306_color_t color) {
+  if (oled == NULL)
+    return;
+
+  _ellipse (oled, x0, y0, rx, ry, true, color);
+}
+
+// Circles are ellipses with equal radii, so the outline and the fill cover the same rows
+void mgos_ssd1306_draw_circle (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, uint16_t r, mgos_ssd1306_color_t color) {
+  if (oled == NULL)
+    return;
+
+  if (r == 0)
+    return;
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x0, y0, r, color };
+    ssd1306_dl_record (oled, SSD1306_DL_CIRCLE, args, NULL, 0);
+    return;
+  }
+
+  _ellipse (oled, x0, y0, r, r, false, color);
+}
+
+void mgos_ssd1306_fill_circle (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, uint16_t r, mgos_ssd1306_color_t color) {
+  if (oled == NULL)
+    return;
+
+  if (r == 0)
+    return;
+
+  _ellipse (oled, x0, y0, r, r, true, color);
+}
+
+static void _round_rect (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t r, bool fill,
+                         mgos_ssd1306_color_t color) {
+  shape_round_rect_t rr = { x, y, w, h, r };
+
+  if (w == 0 || h == 0)
+    return;
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x, y, w, h, r, color };
+    ssd1306_dl_record (oled, fill ? SSD1306_DL_FILL_ROUND_RECTANGLE : SSD1306_DL_ROUND_RECTANGLE, args, NULL, 0);
+    return;
+  }
+  // corners can take at most half of either side
+  if (rr.r > (w - 1) / 2)
+    rr.r = (w - 1) / 2;
+  if (rr.r > (h - 1) / 2)
+    rr.r = (h - 1) / 2;
+
+  if (fill)
+    _fill_shape (oled, x, x + w - 1, _round_rect_col, &rr, color);
+  else
+    _outline_shape (oled, x, x + w - 1, _round_rect_col, &rr, color);
+  _mark_dirty_clipped (oled, x, y, x + w - 1, y + h - 1);
+}
+
+void mgos_ssd1306_draw_round_rectangle (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t r,
+                                        mgos_ssd1306_color_t color) {
+  if (oled == NULL)
+    return;
+
+  _round_rect (oled, x, y, w, h, r, false, color);
+}
+
+void mgos_ssd1306_fill_round_rectangle (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t r,
+                                        mgos_ssd1306_color_t color) {
+  if (oled == NULL)
+    return;
+
+  _round_rect (oled, x, y, w, h, r, true, color);
+}
+
+// Clockwise arc sector between two direction vectors (screen Y grows downwards)
+typedef struct {
+  int32_t sx, sy;               // start direction
+  int32_t ex, ey;               // end direction
+  bool wide;                    // sweep is more than half a turn
+  bool full;                    // sweep is a whole turn
+} shape_sector_t;
+
+// sin() of 0 to 90 degrees, scaled by 1024
+static const int16_t s_sin[91] = {
+  0, 18, 36, 54, 71, 89, 107, 125, 143, 160, 178, 195, 213,
+  230, 248, 265, 282, 299, 316, 333, 350, 367, 384, 400, 416, 433,
+  449, 465, 481, 496, 512, 527, 543, 558, 573, 587, 602, 616, 630,
+  644, 658, 672, 685, 698, 711, 724, 737, 749, 761, 773, 784, 796,
+  807, 818, 828, 839, 849, 859, 868, 878, 887, 896, 904, 912, 920,
+  928, 935, 943, 949, 956, 962, 968, 974, 979, 984, 989, 994, 998,
+  1002, 1005, 1008, 1011, 1014, 1016, 1018, 1020, 1022, 1023, 1023, 1024, 1024,
+};
+
+static int32_t _sin (int32_t angle) {
+  angle %= 360;
+  if (angle < 0)
+    angle += 360;
+  if (angle <= 90)
+    return s_sin[angle];
+  if (angle <= 180)
+    return s_sin[180 - angle];
+  if (angle <= 270)
+    return -s_sin[angle - 180];
+  return -s_sin[360 - angle];
+}
+
+static void _angle_vector (int16_t angle, int32_t *x, int32_t *y) {
+  *x = _sin ((int32_t) angle + 90);
+  *y = _sin (angle);
+}
+
+static int32_t _floor_div (int32_t n, int32_t d) {
+  int32_t q = n / d;
+
+  if (n % d != 0 && (n < 0) != (d < 0))
+    --q;
+  return q;
+}
+
+// Narrow the rows [*lo, *hi] of a column to those with k * dy >= c
+static void _half_plane (int32_t k, int32_t c, int32_t *lo, int32_t *hi) {
+  int32_t limit;
+
+  if (k > 0) {
+    limit = -_floor_div (-c, k);
+    if (*lo < limit)
+      *lo = limit;
+  } else if (k < 0) {
+    limit = _floor_div (c, k);
+    if (*hi > limit)
+      *hi = limit;
+  } else if (c > 0) {
+    *hi = *lo - 1;
+  }
+}
+
+// Draw rows lo to hi of a column relative to y0, less the rows of two cuts
+static void _arc_spans (struct mgos_ssd1306 *oled, int16_t x, int16_t y0, int32_t lo, int32_t hi, const int32_t *cuts,
+                        mgos_ssd1306_color_t color) {
+  uint8_t first = (cuts[2] < cuts[0]) ? 2 : 0;
+
+  for (uint8_t i = 0; i < 4; i += 2) {
+    const int32_t *cut = &cuts[first ^ i];
+
+    if (cut[0] > cut[1])
+      continue;
+    if (lo < cut[0])
+      _col_span (oled, x, y0 + lo, y0 + ((cut[0] - 1 < hi) ? cut[0] - 1 : hi), color);
+    if (lo <= cut[1])
+      lo = cut[1] + 1;
+  }
+  if (lo <= hi)
+    _col_span (oled, x, y0 + lo, y0 + hi, color);
+}
+
+void mgos_ssd1306_draw_arc (struct mgos_ssd1306 *oled, int16_t x0, int16_t y0, uint16_t r, int16_t start_angle,
+                            int16_t end_angle, uint16_t thickness, mgos_ssd1306_color_t color) {
+  shape_sector_t sector;
+  int32_t sweep;
+  int16_t left, right, ri;
+
+  if (oled == NULL || r == 0 || thickness == 0 || start_angle == end_angle)
+    return;
+  if (oled->dlist != NULL) {
+    const int16_t args[] = { x0, y0, r, start_angle, end_angle, thickness, color };
+    ssd1306_dl_record (oled, SSD1306_DL_ARC, args, NULL, 0);
+    return;
+  }
+
+  sweep = ((int32_t) end_angle - start_angle) % 360;
+  if (sweep < 0)
+    sweep += 360;
+  sector.full = (sweep == 0);
+  sector.wide = (sweep > 180);
+  _angle_vector (start_angle, &sector.sx, &sector.sy);
+  _angle_vector (end_angle, &sector.ex, &sector.ey);
+
+  // ring between the disc of radius r and the hole of radius ri, same rule as circles;
+  // in each column the sector boundaries are two half planes, giving the rows directly
+  ri = (int16_t) r - thickness;
+  left = (x0 - r < oled->clip_left) ? oled->clip_left : x0 - r;
+  right = (x0 + r > oled->clip_right) ? oled->clip_right : x0 + r;
+  for (int16_t x = left; x <= right; ++x) {
+    int32_t dx = x - x0;
+    int16_t ho = _ellipse_height (r, r, abs (dx));
+    int16_t hi = (ri > 0) ? _ellipse_height (ri, ri, abs (dx)) : -1;
+    int32_t lo = -ho, top = ho;
+    int32_t cuts[4] = { -hi, hi, 1, 0 };    // the hole, and the rows outside a wide sector
+
+    if (ho < 0)
+      continue;
+    if (sector.wide) {
+      // a wide sector is all but the open sector from its end back to its start
+      cuts[2] = -ho;
+      cuts[3] = ho;
+      _half_plane (sector.ex, sector.ey * dx + 1, &cuts[2], &cuts[3]);
+      _half_plane (-sector.sx, 1 - sector.sy * dx, &cuts[2], &cuts[3]);
+    } else if (!sector.full) {
+      _half_plane (sector.sx, sector.sy * dx, &lo, &top);
+      _half_plane (-sector.ex, -sector.ey * dx, &lo, &top);
+    }
+    if (lo <= top)
+      _arc_spans (oled, x, y0, lo, top, cuts, color);
+  }
+  _mark_dirty_clipped (oled, x0 - r, y0 - r, x0 + r, y0 + r);
+}
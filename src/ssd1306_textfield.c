@@ -0,0 +1,228 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Incremental text fields.
+ *
+ * A text field remembers the character and x position of every glyph it drew.
+ * Setting new text lays it out, then pairs each new glyph with the old glyph at the
+ * same x. Glyphs that match keep their pixels; the cells of the other old glyphs
+ * are cleared and the other new glyphs drawn. With right alignment or a
+ * proportional font, a glyph that moved counts as changed. A clock going from
+ * "12:34:56" to "12:34:57" redraws one glyph cell.
+ *
+ * Display lists find changes themselves, so while one is recorded the whole field
+ * is drawn.
+ */
+
+#include "ssd1306_internal.h"
+
+typedef struct {
+  int16_t x;                    // left edge of the glyph cell
+  unsigned char c;
+  bool keep;                    // glyph is unchanged
+} glyph_t;
+
+struct mgos_ssd1306_textfield {
+  struct mgos_ssd1306 *oled;
+  int16_t x;                    // bounds; the height is the font's
+  int16_t y;
+  uint16_t w;
+  uint8_t font;
+  uint8_t align;                // mgos_ssd1306_align_t
+  mgos_ssd1306_color_t foreground;
+  mgos_ssd1306_color_t background;
+  bool valid;                   // the canvas shows glyphs
+  uint16_t len;                 // number of glyphs shown
+  uint16_t size;                // capacity of each glyph array
+  glyph_t *glyphs;              // glyphs shown, followed by the new layout
+};
+
+// Clear the cell of glyph i of n, including the spacing up to the next glyph
+static void _clear_cell (struct mgos_ssd1306_textfield *tf, const glyph_t *g, uint16_t i, uint16_t n) {
+  const font_info_t *font = tf->oled->font;
+  uint16_t w = _glyph_width (font, g[i].c) + ((i + 1 < n) ? font->c : 0);
+
+  mgos_ssd1306_fill_rectangle (tf->oled, g[i].x, tf->y, w, font->height, tf->background);
+}
+
+struct mgos_ssd1306_textfield *mgos_ssd1306_textfield_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w,
+                                                              uint8_t font, mgos_ssd1306_align_t align) {
+  struct mgos_ssd1306_textfield *tf;
+
+  if (oled == NULL)
+    return NULL;
+
+  tf = calloc (1, sizeof (*tf));
+  if (tf == NULL) {
+    LOG (LL_ERROR, ("Out of memory creating text field"));
+    return NULL;
+  }
+  tf->oled = oled;
+  tf->x = x;
+  tf->y = y;
+  tf->w = w;
+  tf->font = font;
+  tf->align = align;
+  tf->foreground = SSD1306_COLOR_WHITE;
+  tf->background = SSD1306_COLOR_BLACK;
+  return tf;
+}
+
+void mgos_ssd1306_textfield_free (struct mgos_ssd1306_textfield *tf) {
+  if (tf == NULL)
+    return;
+
+  free (tf->glyphs);
+  free (tf);
+}
+
+void mgos_ssd1306_textfield_set_colors (struct mgos_ssd1306_textfield *tf, mgos_ssd1306_color_t foreground,
+                                        mgos_ssd1306_color_t background) {
+  if (tf == NULL)
+    return;
+
+  // glyph cells are cleared with the background, so it has to be opaque
+  if (background != SSD1306_COLOR_WHITE)
+    background = SSD1306_COLOR_BLACK;
+  if (tf->foreground != foreground || tf->background != background)
+    tf->valid = false;
+  tf->foreground = foreground;
+  tf->background = background;
+}
+
+void mgos_ssd1306_textfield_invalidate (struct mgos_ssd1306_textfield *tf) {
+  if (tf == NULL)
+    return;
+
+  tf->valid = false;
+}
+
+void mgos_ssd1306_textfield_set_text (struct mgos_ssd1306_textfield *tf, const char *text) {
+  struct mgos_ssd1306 *oled;
+  const font_info_t *font;
+  int16_t clip[4];
+  int32_t left, top, right, bottom, x;
+  size_t n;
+  glyph_t *old, *new;
+
+  if (tf == NULL)
+    return;
+  if (text == NULL)
+    text = "";
+
+  oled = tf->oled;
+  n = strlen (text);
+  if (n > UINT16_MAX / 2)
+    n = UINT16_MAX / 2;
+  if (n > tf->size) {
+    glyph_t *glyphs = malloc (2 * n * sizeof (glyph_t));
+
+    if (glyphs == NULL) {
+      LOG (LL_ERROR, ("Out of memory setting text field"));
+      return;
+    }
+    if (tf->len)
+      memcpy (glyphs, tf->glyphs, tf->len * sizeof (glyph_t));
+    free (tf->glyphs);
+    tf->glyphs = glyphs;
+    tf->size = n;
+  }
+  old = tf->glyphs;
+  new = tf->glyphs + tf->size;
+
+  font = oled->font;
+  mgos_ssd1306_select_font (oled, tf->font);
+
+  // lay out the new text
+  x = 0;
+  for (size_t i = 0; i < n; ++i)
+    x += _glyph_width (oled->font, text[i]) + ((i + 1 < n) ? oled->font->c : 0);
+  if (tf->align == SSD1306_ALIGN_RIGHT)
+    x = tf->x + (int32_t) tf->w - x;
+  else if (tf->align == SSD1306_ALIGN_CENTER)
+    x = tf->x + ((int32_t) tf->w - x) / 2;
+  else
+    x = tf->x;
+  for (size_t i = 0; i < n; ++i) {
+    new[i].x = x;
+    new[i].c = text[i];
+    new[i].keep = false;
+    x += _glyph_width (oled->font, text[i]) + oled->font->c;
+  }
+
+  // pair glyphs at the same position, both layouts run left to right
+  for (uint16_t i = 0; i < tf->len; ++i)
+    old[i].keep = false;
+  if (tf->valid && oled->dlist == NULL) {
+    for (uint16_t i = 0, j = 0; i < n && j < tf->len;) {
+      if (old[j].x < new[i].x) {
+        j++;
+      } else if (old[j].x > new[i].x) {
+        i++;
+      } else {
+        if (old[j].c == new[i].c)
+          old[j].keep = new[i].keep = true;
+        i++;
+        j++;
+      }
+    }
+  }
+
+  // draw inside the field only
+  clip[0] = oled->clip_left;
+  clip[1] = oled->clip_top;
+  clip[2] = oled->clip_right;
+  clip[3] = oled->clip_bottom;
+  left = (tf->x > clip[0]) ? tf->x : clip[0];
+  top = (tf->y > clip[1]) ? tf->y : clip[1];
+  right = ((int32_t) tf->x + tf->w - 1 < clip[2]) ? (int32_t) tf->x + tf->w - 1 : clip[2];
+  bottom = ((int32_t) tf->y + oled->font->height - 1 < clip[3]) ? (int32_t) tf->y + oled->font->height - 1 : clip[3];
+  if (left <= right && top <= bottom) {
+    mgos_ssd1306_set_clip (oled, left, top, right - left + 1, bottom - top + 1);
+    if (!tf->valid || oled->dlist != NULL) {
+      mgos_ssd1306_fill_rectangle (oled, tf->x, tf->y, tf->w, oled->font->height, tf->background);
+    } else {
+      for (uint16_t j = 0; j < tf->len; ++j) {
+        if (!old[j].keep)
+          _clear_cell (tf, old, j, tf->len);
+      }
+    }
+    for (uint16_t i = 0; i < n; ++i) {
+      if (new[i].keep)
+        continue;
+      if (tf->valid && oled->dlist == NULL)
+        _clear_cell (tf, new, i, n);
+      mgos_ssd1306_draw_char (oled, new[i].x, tf->y, new[i].c, tf->foreground, SSD1306_COLOR_TRANSPARENT);
+    }
+    mgos_ssd1306_set_clip (oled, clip[0], clip[1], clip[2] - clip[0] + 1, clip[3] - clip[1] + 1);
+  }
+  oled->font = font;
+
+  if (n)
+    memcpy (old, new, n * sizeof (glyph_t));
+  tf->len = n;
+  // what a display list draws is only known once it is rendered
+  tf->valid = (oled->dlist == NULL && left <= right && top <= bottom);
+}
@@ -0,0 +1,258 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Scrolling tickers.
+ *
+ * A ticker shows its text as an endless stream of columns moving left through a
+ * one line box: the columns of each glyph, the font's spacing after it, and after
+ * the last glyph as many blank columns as the box is wide, so the text leaves the
+ * box before it comes in again. The ticker keeps its place in the stream as a glyph
+ * and a column within it. A step moves the box left with
+ * mgos_ssd1306_scroll_region(), which moves whole page rows, and draws only the
+ * columns that come in, straight from the glyph bitmaps; the text is never laid
+ * out or measured again.
+ *
+ * Text no wider than a full width box on page boundaries can instead be left to the
+ * controller's horizontal scroll, which then moves it around the panel without any
+ * transfers; the next step, new text or freeing the ticker stops it.
+ */
+
+#include "ssd1306_internal.h"
+
+struct mgos_ssd1306_ticker {
+  struct mgos_ssd1306 *oled;
+  int16_t x;                    // bounds; the height is the font's
+  int16_t y;
+  uint16_t w;
+  uint8_t font;
+  mgos_ssd1306_color_t foreground;
+  mgos_ssd1306_color_t background;
+  bool valid;                   // the box shows the stream up to the current column
+  bool hardware;                // the controller is scrolling the box
+  char *text;
+  uint16_t len;
+  uint16_t glyph;               // glyph of the next column, len for the blank columns
+  uint16_t column;              // next column within the glyph and its spacing
+};
+
+// Controller scroll step intervals in frames, by their command code
+static const uint16_t s_intervals[8] = { 5, 64, 128, 256, 3, 4, 25, 2 };
+
+static void _stop_hardware (struct mgos_ssd1306_ticker *t) {
+  struct mgos_ssd1306 *oled = t->oled;
+  int16_t top = t->y & ~7, bottom = ((int32_t) t->y + fonts[t->font]->height - 1) | 7;
+
+  if (!t->hardware)
+    return;
+  t->hardware = false;
+  mgos_ssd1306_command (oled, 0x2e);    // SSD1306_SCROLLSTOP
+  // the controller's memory of the scrolled pages is out of step with the canvas
+  _mark_dirty (oled, oled->view_x, top, oled->view_x + oled->width - 1, bottom);
+  t->valid = false;
+}
+
+struct mgos_ssd1306_ticker *mgos_ssd1306_ticker_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w,
+                                                        uint8_t font) {
+  struct mgos_ssd1306_ticker *t;
+
+  if (oled == NULL)
+    return NULL;
+
+  t = calloc (1, sizeof (*t));
+  if (t == NULL) {
+    LOG (LL_ERROR, ("Out of memory creating ticker"));
+    return NULL;
+  }
+  t->oled = oled;
+  t->x = x;
+  t->y = y;
+  t->w = w;
+  t->font = (font < NUM_FONTS) ? font : 0;
+  t->foreground = SSD1306_COLOR_WHITE;
+  t->background = SSD1306_COLOR_BLACK;
+  return t;
+}
+
+void mgos_ssd1306_ticker_free (struct mgos_ssd1306_ticker *t) {
+  if (t == NULL)
+    return;
+
+  _stop_hardware (t);
+  free (t->text);
+  free (t);
+}
+
+void mgos_ssd1306_ticker_set_colors (struct mgos_ssd1306_ticker *t, mgos_ssd1306_color_t foreground,
+                                     mgos_ssd1306_color_t background) {
+  if (t == NULL)
+    return;
+
+  // columns come in on the background, so it has to be opaque
+  if (background != SSD1306_COLOR_WHITE)
+    background = SSD1306_COLOR_BLACK;
+  if (t->foreground != foreground || t->background != background)
+    t->valid = false;
+  t->foreground = foreground;
+  t->background = background;
+}
+
+void mgos_ssd1306_ticker_set_text (struct mgos_ssd1306_ticker *t, const char *text) {
+  char *copy;
+
+  if (t == NULL)
+    return;
+  if (text == NULL)
+    text = "";
+
+  if ((copy = strdup (text)) == NULL) {
+    LOG (LL_ERROR, ("Out of memory setting ticker text"));
+    return;
+  }
+  _stop_hardware (t);
+  free (t->text);
+  t->text = copy;
+  t->len = (strlen (copy) < UINT16_MAX) ? strlen (copy) : UINT16_MAX;
+  t->valid = false;
+}
+
+// Draw the next column of the stream at x, on the background the box was scrolled
+// in with, and move on
+static void _column (struct mgos_ssd1306_ticker *t, int16_t x, bool draw) {
+  const font_info_t *font = t->oled->font;
+
+  if (t->glyph < t->len) {
+    unsigned char c = t->text[t->glyph];
+    uint8_t width;
+
+    if (c < (unsigned char) font->char_start || c > (unsigned char) font->char_end)
+      c = ' ';
+    width = font->char_descriptors[c - font->char_start].width;
+    if (draw && t->column < width) {
+      const uint8_t *bitmap = font->bitmap + font->char_descriptors[c - font->char_start].offset + t->column / 8;
+      uint8_t bit = 0x80 >> (t->column & 7), stride = (width + 7) / 8;
+
+      for (uint8_t j = 0; j < font->height; ++j, bitmap += stride) {
+        if (*bitmap & bit)
+          _plot (t->oled, x, t->y + j, t->foreground);
+      }
+    }
+    if (++t->column >= width + font->c) {
+      t->glyph++;
+      t->column = 0;
+    }
+  } else if (++t->column >= t->w) {
+    t->glyph = 0;
+    t->column = 0;
+  }
+}
+
+void mgos_ssd1306_ticker_step (struct mgos_ssd1306_ticker *t, uint16_t n) {
+  struct mgos_ssd1306 *oled;
+  const font_info_t *font;
+
+  if (t == NULL || n == 0)
+    return;
+  oled = t->oled;
+  if (oled->dlist != NULL) {
+    LOG (LL_ERROR, ("SSD1306 ticker needs a frame buffer and cannot be recorded in a display list"));
+    return;
+  }
+
+  _stop_hardware (t);
+  font = oled->font;
+  mgos_ssd1306_select_font (oled, t->font);
+  if (!t->valid) {
+    // start over with an empty box, the text comes in from the right
+    mgos_ssd1306_fill_rectangle (oled, t->x, t->y, t->w, oled->font->height, t->background);
+    t->glyph = 0;
+    t->column = 0;
+    t->valid = true;
+  }
+  // columns that would scroll through the whole box are skipped
+  while (n > t->w) {
+    _column (t, 0, false);
+    n--;
+  }
+  mgos_ssd1306_scroll_region (oled, t->x, t->y, t->w, oled->font->height, -(int16_t) n, 0, t->background);
+  for (uint16_t i = n; i > 0; --i)
+    _column (t, (int32_t) t->x + t->w - i, true);
+  oled->font = font;
+}
+
+bool mgos_ssd1306_ticker_start_hardware (struct mgos_ssd1306_ticker *t, uint16_t frames) {
+  struct mgos_ssd1306 *oled;
+  const font_info_t *font;
+  uint16_t width = 0;
+  uint8_t code = 0, page_start, page_end;
+
+  if (t == NULL)
+    return false;
+  oled = t->oled;
+
+  font = oled->font;
+  mgos_ssd1306_select_font (oled, t->font);
+  for (uint16_t i = 0; i < t->len; ++i)
+    width += _glyph_width (oled->font, t->text[i]) + oled->font->c;
+  page_start = (t->y - oled->view_y) / 8;
+  page_end = (t->y - oled->view_y + oled->font->height - 1) / 8;
+  // the controller scrolls whole pages around all of its 128 columns
+  if (oled->frame != NULL || oled->dlist != NULL || oled->target != NULL || oled->layers != NULL || oled->gray != NULL ||
+      oled->rotation || oled->width != 128 || oled->col_offset != 0 || t->x != oled->view_x || t->w != oled->width ||
+      t->y < oled->view_y || ((t->y - oled->view_y) & 7) || (oled->view_y & 7) || page_end >= oled->height / 8 ||
+      width > t->w) {
+    oled->font = font;
+    LOG (LL_ERROR, ("SSD1306 ticker cannot use hardware scrolling"));
+    return false;
+  }
+
+  _stop_hardware (t);
+  // the text once, at the left of the box
+  mgos_ssd1306_fill_rectangle (oled, t->x, t->y, t->w, oled->font->height, t->background);
+  mgos_ssd1306_draw_string_color (oled, t->x, t->y, t->text, t->foreground, SSD1306_COLOR_TRANSPARENT);
+  oled->font = font;
+  mgos_ssd1306_refresh (oled, false);
+
+  for (uint8_t i = 1; i < ARRAY_SIZE (s_intervals); ++i) {
+    if (abs ((int) s_intervals[i] - frames) < abs ((int) s_intervals[code] - frames))
+      code = i;
+  }
+  mgos_ssd1306_command (oled, 0x27);    // SSD1306_LEFT_HORIZONTAL_SCROLL
+  mgos_ssd1306_command (oled, 0x00);
+  mgos_ssd1306_command (oled, page_start);
+  mgos_ssd1306_command (oled, code);
+  mgos_ssd1306_command (oled, page_end);
+  mgos_ssd1306_command (oled, 0x00);
+  mgos_ssd1306_command (oled, 0xff);
+  mgos_ssd1306_command (oled, 0x2f);    // SSD1306_ACTIVATE_SCROLL
+  t->hardware = true;
+  return true;
+}
+
+void mgos_ssd1306_ticker_stop_hardware (struct mgos_ssd1306_ticker *t) {
+  if (t == NULL)
+    return;
+
+  _stop_hardware (t);
+}
@@ -0,0 +1,757 @@
+/**
+ * Copyright 2018 Brandon Davidson <brad@oatmail.org>
+ * copyright 2018 Manfred Mueller-Spaeth <fms1961@gmail.com> (changes, additions)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **/
+
+
+/*
+ * Retained widgets.
+ *
+ * Widgets remember their bounds and properties. Setters that actually change
+ * something add the widget's bounds to its damage rectangle; moving or hiding a
+ * widget damages the area it leaves as well. The update pass clears each damaged
+ * rectangle and redraws, clipped to it, every visible widget overlapping it in
+ * creation order, then refreshes, so only damaged areas are drawn and sent.
+ *
+ * Without a frame buffer the driver already works out what changed from its display
+ * list, so the update pass simply records all visible widgets as a new frame.
+ *
+ * Strip charts keep their samples in a ring and draw one column per sample. A new
+ * sample does not damage the chart: its area is scrolled left by a column, which
+ * moves whole page rows, and only the new rightmost column is drawn, so the next
+ * refresh sends just the chart. Anything that would make this differ from a redraw,
+ * such as a widget overlapping the chart or pending damage, falls back to damage.
+ * Bar graphs work the same way: a new bar value fills or clears only the rows
+ * between the old and the new bar top.
+ */
+
+#include "ssd1306_internal.h"
+
+typedef enum {
+  WIDGET_LABEL,
+  WIDGET_VALUE,
+  WIDGET_PROGRESS,
+  WIDGET_ICON,
+  WIDGET_LIST,
+  WIDGET_CHART,
+  WIDGET_BARS,
+} widget_type_t;
+
+struct mgos_ssd1306_widget {
+  struct mgos_ssd1306_widget *next;     // next widget in drawing order
+  struct mgos_ssd1306 *oled;
+  uint8_t type;                 // widget_type_t
+  uint8_t font;
+  uint8_t align;                // mgos_ssd1306_align_t
+  bool visible;
+  int16_t x;                    // bounds
+  int16_t y;
+  uint16_t w;
+  uint16_t h;
+  int16_t damage_left;          // area to redraw, empty when right < left
+  int16_t damage_top;
+  int16_t damage_right;
+  int16_t damage_bottom;
+  mgos_ssd1306_color_t foreground;
+  mgos_ssd1306_color_t background;
+  char *text;                   // label text, value unit
+  int32_t value;                // value, progress
+  int32_t min;                  // progress, chart range
+  int32_t max;
+  uint8_t decimals;             // value
+  const void *data;             // icon bitmap, list items
+  uint16_t count;               // list item count, chart samples kept, bar count
+  uint16_t selected;            // list selection
+  uint16_t top;                 // first visible list item
+  uint8_t series;               // chart values per sample
+  uint16_t slots;               // chart ring size in samples
+  uint16_t head;                // chart ring slot of the next sample
+  int32_t *samples;             // chart ring, series values per slot; bar values
+};
+
+static void _damage (struct mgos_ssd1306_widget *w, int32_t left, int32_t top, int32_t right, int32_t bottom) {
+  // only the canvas can be damaged
+  if (left < 0)
+    left = 0;
+  if (top < 0)
+    top = 0;
+  if (right >= w->oled->canvas_width)
+    right = w->oled->canvas_width - 1;
+  if (bottom >= w->oled->canvas_height)
+    bottom = w->oled->canvas_height - 1;
+  if (left > right || top > bottom)
+    return;
+
+  if (w->damage_right < w->damage_left) {
+    w->damage_left = left;
+    w->damage_top = top;
+    w->damage_right = right;
+    w->damage_bottom = bottom;
+    return;
+  }
+  if (w->damage_left > left)
+    w->damage_left = left;
+  if (w->damage_top > top)
+    w->damage_top = top;
+  if (w->damage_right < right)
+    w->damage_right = right;
+  if (w->damage_bottom < bottom)
+    w->damage_bottom = bottom;
+}
+
+static inline void _damage_bounds (struct mgos_ssd1306_widget *w) {
+  _damage (w, w->x, w->y, (int32_t) w->x + w->w - 1, (int32_t) w->y + w->h - 1);
+}
+
+// X of a text of the given width inside the widget
+static int16_t _text_x (const struct mgos_ssd1306_widget *w, uint16_t width) {
+  switch (w->align) {
+  case SSD1306_ALIGN_CENTER:
+    return w->x + ((int32_t) w->w - width) / 2;
+  case SSD1306_ALIGN_RIGHT:
+    return w->x + (int32_t) w->w - width;
+  default:
+    return w->x;
+  }
+}
+
+static void _draw_text (struct mgos_ssd1306_widget *w, const char *text) {
+  struct mgos_ssd1306 *oled = w->oled;
+
+  mgos_ssd1306_draw_string_color (oled, _text_x (w, mgos_ssd1306_measure_string (oled, text)), w->y, text, w->foreground,
+                                  SSD1306_COLOR_TRANSPARENT);
+}
+
+static void _draw_value (struct mgos_ssd1306_widget *w) {
+  char buf[32];
+  uint32_t v = (w->value < 0) ? -(uint32_t) w->value : (uint32_t) w->value;
+  uint32_t scale = 1;
+
+  for (uint8_t i = 0; i < w->decimals; ++i)
+    scale *= 10;
+  if (w->decimals)
+    snprintf (buf, sizeof (buf), "%s%lu.%0*lu%s", (w->value < 0) ? "-" : "", (unsigned long) (v / scale), (int) w->decimals % 10,
+              (unsigned long) (v % scale), w->text ? w->text : "");
+  else
+    snprintf (buf, sizeof (buf), "%ld%s", (long) w->value, w->text ? w->text : "");
+  _draw_text (w, buf);
+}
+
+static void _draw_progress (struct mgos_ssd1306_widget *w) {
+  struct mgos_ssd1306 *oled = w->oled;
+  int32_t value = w->value, fill = 0;
+
+  mgos_ssd1306_draw_rectangle (oled, w->x, w->y, w->w, w->h, w->foreground);
+  if (w->w <= 2 || w->h <= 2 || w->max <= w->min)
+    return;
+  if (value < w->min)
+    value = w->min;
+  if (value > w->max)
+    value = w->max;
+  fill = (int32_t) ((int64_t) (value - w->min) * (w->w - 2) / ((int64_t) w->max - w->min));
+  if (fill)
+    mgos_ssd1306_fill_rectangle (oled, w->x + 1, w->y + 1, fill, w->h - 2, w->foreground);
+}
+
+static void _draw_list (struct mgos_ssd1306_widget *w) {
+  struct mgos_ssd1306 *oled = w->oled;
+  const char *const *items = w->data;
+  uint16_t row_height = mgos_ssd1306_get_font_height (oled) + 1;
+  int16_t y = w->y;
+
+  for (uint16_t i = w->top; i < w->count && y + row_height <= w->y + w->h; ++i, y += row_height) {
+    mgos_ssd1306_color_t color = w->foreground;
+
+    if (i == w->selected) {
+      // the selection is drawn inverted
+      mgos_ssd1306_fill_rectangle (oled, w->x, y, w->w, row_height, w->foreground);
+      color = (w->background == SSD1306_COLOR_TRANSPARENT) ? SSD1306_COLOR_INVERT : w->background;
+    }
+    if (items[i] != NULL)
+      mgos_ssd1306_draw_string_color (oled, w->x + 1, y, items[i], color, SSD1306_COLOR_TRANSPARENT);
+  }
+}
+
+// Row of a chart value; values outside the range are drawn at its edges
+static int16_t _chart_y (const struct mgos_ssd1306_widget *w, int32_t value) {
+  int32_t bottom = (int32_t) w->y + w->h - 1;
+
+  if (w->h == 0 || w->max <= w->min || value <= w->min)
+    return bottom;
+  if (value >= w->max)
+    return w->y;
+  return bottom - (int32_t) ((int64_t) (value - w->min) * (w->h - 1) / ((int64_t) w->max - w->min));
+}
+
+// Draw the sample age samples old in column x: a vertical segment per series from
+// the previous sample's row to its own, so that consecutive samples join up
+static void _chart_column (struct mgos_ssd1306_widget *w, int16_t x, uint16_t age) {
+  uint16_t slot = (w->head + 2 * w->slots - 1 - age) % w->slots;
+  uint16_t prev = (slot + w->slots - 1) % w->slots;
+
+  for (uint8_t s = 0; s < w->series; ++s) {
+    int16_t y0 = _chart_y (w, w->samples[slot * w->series + s]), y1 = y0;
+
+    if (age + 1 < w->count)
+      y0 = _chart_y (w, w->samples[prev * w->series + s]);
+    if (y0 > y1) {
+      int16_t t = y0;
+
+      y0 = y1;
+      y1 = t;
+    }
+    mgos_ssd1306_draw_vline (w->oled, x, y0, y1 - y0 + 1, w->foreground);
+  }
+}
+
+// The newest samples, right aligned
+static void _draw_chart (struct mgos_ssd1306_widget *w) {
+  uint16_t n = (w->count < w->w) ? w->count : w->w;
+
+  for (uint16_t age = 0; age < n; ++age)
+    _chart_column (w, (int32_t) w->x + w->w - 1 - age, age);
+}
+
+// Columns of bar i, leaving a column between bars wider than one
+static void _bar_span (const struct mgos_ssd1306_widget *w, uint16_t i, int16_t *x, uint16_t *width) {
+  int32_t left = (int32_t) i * w->w / w->count, right = (int32_t) (i + 1) * w->w / w->count;
+
+  *x = w->x + left;
+  *width = (right - left > 1) ? right - left - 1 : right - left;
+}
+
+// Height of a bar value in rows
+static uint16_t _bar_height (const struct mgos_ssd1306_widget *w, int32_t value) {
+  if (w->max <= w->min || value <= w->min)
+    return 0;
+  if (value >= w->max)
+    return w->h;
+  return (uint16_t) ((int64_t) (value - w->min) * w->h / ((int64_t) w->max - w->min));
+}
+
+static void _draw_bars (struct mgos_ssd1306_widget *w) {
+  for (uint16_t i = 0; i < w->count; ++i) {
+    uint16_t width, height = _bar_height (w, w->samples[i]);
+    int16_t x;
+
+    _bar_span (w, i, &x, &width);
+    if (height)
+      mgos_ssd1306_fill_rectangle (w->oled, x, (int32_t) w->y + w->h - height, width, height, w->foreground);
+  }
+}
+
+// Draw a widget clipped to its bounds; the clip is recorded along with the drawing in paged mode
+static void _draw (struct mgos_ssd1306_widget *w) {
+  struct mgos_ssd1306 *oled = w->oled;
+  const font_info_t *font = oled->font;
+  int16_t clip[4] = { oled->clip_left, oled->clip_top, oled->clip_right, oled->clip_bottom };
+  int32_t left = (w->x > clip[0]) ? w->x : clip[0];
+  int32_t top = (w->y > clip[1]) ? w->y : clip[1];
+  int32_t right = ((int32_t) w->x + w->w - 1 < clip[2]) ? (int32_t) w->x + w->w - 1 : clip[2];
+  int32_t bottom = ((int32_t) w->y + w->h - 1 < clip[3]) ? (int32_t) w->y + w->h - 1 : clip[3];
+
+  if (left > right || top > bottom)
+    return;
+  mgos_ssd1306_set_clip (oled, left, top, right - left + 1, bottom - top + 1);
+  if (w->background != SSD1306_COLOR_TRANSPARENT)
+    mgos_ssd1306_fill_rectangle (oled, w->x, w->y, w->w, w->h, w->background);
+  mgos_ssd1306_select_font (oled, w->font);
+
+  switch (w->type) {
+  case WIDGET_LABEL:
+    if (w->text != NULL)
+      _draw_text (w, w->text);
+    break;
+  case WIDGET_VALUE:
+    _draw_value (w);
+    break;
+  case WIDGET_PROGRESS:
+    _draw_progress (w);
+    break;
+  case WIDGET_ICON:
+    if (w->data != NULL)
+      mgos_ssd1306_draw_bitmap (oled, w->x, w->y, w->w, w->h, w->data, w->foreground, SSD1306_COLOR_TRANSPARENT);
+    break;
+  case WIDGET_LIST:
+    _draw_list (w);
+    break;
+  case WIDGET_CHART:
+    _draw_chart (w);
+    break;
+  case WIDGET_BARS:
+    _draw_bars (w);
+    break;
+  }
+  oled->font = font;
+  mgos_ssd1306_set_clip (oled, clip[0], clip[1], clip[2] - clip[0] + 1, clip[3] - clip[1] + 1);
+}
+
+// Clear a rectangle and redraw the visible widgets overlapping it, clipped to it
+static void _redraw (struct mgos_ssd1306 *oled, int16_t left, int16_t top, int16_t right, int16_t bottom) {
+  int16_t clip[4] = { oled->clip_left, oled->clip_top, oled->clip_right, oled->clip_bottom };
+
+  oled->clip_left = left;
+  oled->clip_top = top;
+  oled->clip_right = right;
+  oled->clip_bottom = bottom;
+  mgos_ssd1306_fill_rectangle (oled, left, top, right - left + 1, bottom - top + 1, SSD1306_COLOR_BLACK);
+  for (struct mgos_ssd1306_widget *w = oled->widgets; w != NULL; w = w->next) {
+    if (w->visible && w->x <= right && (int32_t) w->x + w->w > left && w->y <= bottom && (int32_t) w->y + w->h > top)
+      _draw (w);
+  }
+  oled->clip_left = clip[0];
+  oled->clip_top = clip[1];
+  oled->clip_right = clip[2];
+  oled->clip_bottom = clip[3];
+}
+
+static struct mgos_ssd1306_widget *_create (struct mgos_ssd1306 *oled, widget_type_t type, int16_t x, int16_t y, uint16_t w,
+                                            uint16_t h) {
+  struct mgos_ssd1306_widget *widget, **tail;
+
+  if (oled == NULL)
+    return NULL;
+
+  widget = calloc (1, sizeof (*widget));
+  if (widget == NULL) {
+    LOG (LL_ERROR, ("Out of memory creating widget"));
+    return NULL;
+  }
+  widget->oled = oled;
+  widget->type = type;
+  widget->visible = true;
+  widget->x = x;
+  widget->y = y;
+  widget->w = w;
+  widget->h = h;
+  widget->damage_right = -1;
+  widget->foreground = SSD1306_COLOR_WHITE;
+  widget->background = SSD1306_COLOR_BLACK;
+  widget->max = 100;
+  _damage_bounds (widget);
+
+  // later widgets are drawn on top
+  for (tail = &oled->widgets; *tail != NULL; tail = &(*tail)->next)
+    ;
+  *tail = widget;
+  return widget;
+}
+
+struct mgos_ssd1306_widget *mgos_ssd1306_label_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                                       const char *text) {
+  struct mgos_ssd1306_widget *widget = _create (oled, WIDGET_LABEL, x, y, w, h);
+
+  mgos_ssd1306_widget_set_text (widget, text);
+  return widget;
+}
+
+struct mgos_ssd1306_widget *mgos_ssd1306_value_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h) {
+  struct mgos_ssd1306_widget *widget = _create (oled, WIDGET_VALUE, x, y, w, h);
+
+  if (widget != NULL)
+    widget->align = SSD1306_ALIGN_RIGHT;
+  return widget;
+}
+
+struct mgos_ssd1306_widget *mgos_ssd1306_progress_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h) {
+  return _create (oled, WIDGET_PROGRESS, x, y, w, h);
+}
+
+struct mgos_ssd1306_widget *mgos_ssd1306_icon_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                                      const uint8_t *bitmap) {
+  struct mgos_ssd1306_widget *widget = _create (oled, WIDGET_ICON, x, y, w, h);
+
+  if (widget != NULL)
+    widget->data = bitmap;
+  return widget;
+}
+
+struct mgos_ssd1306_widget *mgos_ssd1306_list_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h) {
+  return _create (oled, WIDGET_LIST, x, y, w, h);
+}
+
+struct mgos_ssd1306_widget *mgos_ssd1306_chart_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                                       uint8_t series) {
+  struct mgos_ssd1306_widget *widget;
+  int32_t *samples;
+
+  if (oled == NULL)
+    return NULL;
+  if (series == 0 || series > SSD1306_CHART_MAX_SERIES) {
+    LOG (LL_ERROR, ("SSD1306 chart with %d series is invalid", series));
+    return NULL;
+  }
+  // one more sample than columns, so the leftmost column still joins its predecessor
+  if ((samples = calloc ((uint32_t) (w + 1) * series, sizeof (*samples))) == NULL) {
+    LOG (LL_ERROR, ("Out of memory creating chart"));
+    return NULL;
+  }
+  if ((widget = _create (oled, WIDGET_CHART, x, y, w, h)) == NULL) {
+    free (samples);
+    return NULL;
+  }
+  widget->series = series;
+  widget->slots = w + 1;
+  widget->samples = samples;
+  return widget;
+}
+
+struct mgos_ssd1306_widget *mgos_ssd1306_bars_create (struct mgos_ssd1306 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                                      uint16_t count) {
+  struct mgos_ssd1306_widget *widget;
+  int32_t *values;
+
+  if (oled == NULL)
+    return NULL;
+  if (count == 0 || count > w) {
+    LOG (LL_ERROR, ("SSD1306 %d bars do not fit in %d columns", count, w));
+    return NULL;
+  }
+  if ((values = calloc (count, sizeof (*values))) == NULL) {
+    LOG (LL_ERROR, ("Out of memory creating bar graph"));
+    return NULL;
+  }
+  if ((widget = _create (oled, WIDGET_BARS, x, y, w, h)) == NULL) {
+    free (values);
+    return NULL;
+  }
+  widget->count = count;
+  widget->samples = values;
+  return widget;
+}
+
+void mgos_ssd1306_widget_free (struct mgos_ssd1306_widget *w) {
+  struct mgos_ssd1306_widget **p;
+
+  if (w == NULL)
+    return;
+
+  for (p = &w->oled->widgets; *p != NULL; p = &(*p)->next) {
+    if (*p == w) {
+      *p = w->next;
+      break;
+    }
+  }
+  // whatever was under the widget shows again on the next update, which redraws the
+  // area as part of another widget's damage; without widgets it is cleared right away
+  if (w->visible) {
+    _damage_bounds (w);
+    if (w->damage_right < w->damage_left) {
+      // off the canvas, nothing to redraw
+    } else if (w->oled->widgets != NULL) {
+      _damage (w->oled->widgets, w->damage_left, w->damage_top, w->damage_right, w->damage_bottom);
+    } else {
+      _redraw (w->oled, w->damage_left, w->damage_top, w->damage_right, w->damage_bottom);
+    }
+  }
+  free (w->samples);
+  free (w->text);
+  free (w);
+}
+
+void ssd1306_widgets_free (struct mgos_ssd1306 *oled) {
+  while (oled->widgets != NULL) {
+    struct mgos_ssd1306_widget *w = oled->widgets;
+
+    oled->widgets = w->next;
+    free (w->samples);
+    free (w->text);
+    free (w);
+  }
+}
+
+void mgos_ssd1306_widget_set_bounds (struct mgos_ssd1306_widget *w, int16_t x, int16_t y, uint16_t width, uint16_t height) {
+  if (w == NULL || (w->x == x && w->y == y && w->w == width && w->h == height))
+    return;
+
+  _damage_bounds (w);
+  w->x = x;
+  w->y = y;
+  w->w = width;
+  w->h = height;
+  _damage_bounds (w);
+}
+
+void mgos_ssd1306_widget_set_visible (struct mgos_ssd1306_widget *w, bool visible) {
+  if (w == NULL || w->visible == visible)
+    return;
+
+  w->visible = visible;
+  _damage_bounds (w);
+}
+
+void mgos_ssd1306_widget_set_colors (struct mgos_ssd1306_widget *w, mgos_ssd1306_color_t foreground,
+                                     mgos_ssd1306_color_t background) {
+  if (w == NULL || (w->foreground == foreground && w->background == background))
+    return;
+
+  w->foreground = foreground;
+  w->background = background;
+  _damage_bounds (w);
+}
+
+void mgos_ssd1306_widget_set_font (struct mgos_ssd1306_widget *w, uint8_t font) {
+  if (w == NULL || font >= NUM_FONTS || w->font == font)
+    return;
+
+  w->font = font;
+  _damage_bounds (w);
+}
+
+void mgos_ssd1306_widget_set_align (struct mgos_ssd1306_widget *w, mgos_ssd1306_align_t align) {
+  if (w == NULL || w->align == align)
+    return;
+
+  w->align = align;
+  _damage_bounds (w);
+}
+
+void mgos_ssd1306_widget_set_text (struct mgos_ssd1306_widget *w, const char *text) {
+  char *copy = NULL;
+
+  if (w == NULL)
+    return;
+  if ((w->text == NULL && text == NULL) || (w->text != NULL && text != NULL && strcmp (w->text, text) == 0))
+    return;
+
+  if (text != NULL) {
+    copy = strdup (text);
+    if (copy == NULL) {
+      LOG (LL_ERROR, ("Out of memory setting widget text"));
+      return;
+    }
+  }
+  free (w->text);
+  w->text = copy;
+  _damage_bounds (w);
+}
+
+void mgos_ssd1306_widget_set_value (struct mgos_ssd1306_widget *w, int32_t value) {
+  if (w == NULL || w->value == value)
+    return;
+
+  w->value = value;
+  _damage_bounds (w);
+}
+
+void mgos_ssd1306_widget_set_range (struct mgos_ssd1306_widget *w, int32_t min, int32_t max) {
+  if (w == NULL || (w->min == min && w->max == max))
+    return;
+
+  w->min = min;
+  w->max = max;
+  _damage_bounds (w);
+}
+
+void mgos_ssd1306_widget_set_format (struct mgos_ssd1306_widget *w, uint8_t decimals, const char *unit) {
+  if (w == NULL)
+    return;
+
+  if (decimals > 9)
+    decimals = 9;
+  if (w->decimals != decimals) {
+    w->decimals = decimals;
+    _damage_bounds (w);
+  }
+  mgos_ssd1306_widget_set_text (w, unit);
+}
+
+void mgos_ssd1306_widget_set_bitmap (struct mgos_ssd1306_widget *w, const uint8_t *bitmap) {
+  if (w == NULL || w->data == bitmap)
+    return;
+
+  w->data = bitmap;
+  _damage_bounds (w);
+}
+
+void mgos_ssd1306_widget_set_items (struct mgos_ssd1306_widget *w, const char *const *items, uint16_t count) {
+  if (w == NULL)
+    return;
+
+  w->data = items;
+  w->count = items ? count : 0;
+  w->selected = 0;
+  w->top = 0;
+  _damage_bounds (w);
+}
+
+void mgos_ssd1306_widget_select (struct mgos_ssd1306_widget *w, uint16_t index) {
+  struct mgos_ssd1306 *oled;
+  const font_info_t *font;
+  uint16_t rows;
+
+  if (w == NULL || w->count == 0)
+    return;
+
+  if (index >= w->count)
+    index = w->count - 1;
+  if (w->selected == index)
+    return;
+  w->selected = index;
+
+  // scroll so the selection stays visible
+  oled = w->oled;
+  font = oled->font;
+  mgos_ssd1306_select_font (oled, w->font);
+  rows = w->h / (mgos_ssd1306_get_font_height (oled) + 1);
+  oled->font = font;
+  if (rows == 0)
+    rows = 1;
+  if (index < w->top)
+    w->top = index;
+  else if (index >= w->top + rows)
+    w->top = index - rows + 1;
+  _damage_bounds (w);
+}
+
+uint16_t mgos_ssd1306_widget_get_selected (struct mgos_ssd1306_widget *w) {
+  if (w == NULL)
+    return 0;
+
+  return w->selected;
+}
+
+void mgos_ssd1306_widget_invalidate (struct mgos_ssd1306_widget *w) {
+  if (w == NULL)
+    return;
+
+  _damage_bounds (w);
+}
+
+// Whether a widget can be changed in the frame buffer right away, drawing exactly
+// what a redraw would: nothing else is pending for it or drawn over it
+static bool _in_place (struct mgos_ssd1306_widget *w) {
+  struct mgos_ssd1306 *oled = w->oled;
+  int32_t right = (int32_t) w->x + w->w - 1, bottom = (int32_t) w->y + w->h - 1;
+
+  if (oled->frame != NULL || oled->dlist != NULL || w->damage_right >= w->damage_left)
+    return false;
+  for (struct mgos_ssd1306_widget *o = oled->widgets; o != NULL; o = o->next) {
+    if (o != w && o->visible && o->x <= right && (int32_t) o->x + o->w > w->x && o->y <= bottom && (int32_t) o->y + o->h > w->y)
+      return false;
+  }
+  return true;
+}
+
+// What a redraw leaves under a widget's content: it clears to black and fills the background
+static inline mgos_ssd1306_color_t _under (const struct mgos_ssd1306_widget *w) {
+  return (w->background == SSD1306_COLOR_WHITE || w->background == SSD1306_COLOR_INVERT) ? SSD1306_COLOR_WHITE : SSD1306_COLOR_BLACK;
+}
+
+// Scroll a chart left by a column and draw its newest sample in the column that
+// opens up; false if the chart has to be redrawn instead
+static bool _chart_scroll (struct mgos_ssd1306_widget *w) {
+  struct mgos_ssd1306 *oled = w->oled;
+  int16_t clip[4] = { oled->clip_left, oled->clip_top, oled->clip_right, oled->clip_bottom };
+  int32_t right = (int32_t) w->x + w->w - 1;
+
+  if (!w->visible)
+    return true;
+  // the newest column has to be on the canvas to scroll into view
+  if (!_in_place (w) || right >= oled->canvas_width)
+    return false;
+
+  // like a redraw, clipped to the canvas
+  _reset_clip (oled);
+  mgos_ssd1306_scroll_region (oled, w->x, w->y, w->w, w->h, -1, 0, _under (w));
+  if (w->w > 0 && w->h > 0)
+    _chart_column (w, right, 0);
+  oled->clip_left = clip[0];
+  oled->clip_top = clip[1];
+  oled->clip_right = clip[2];
+  oled->clip_bottom = clip[3];
+  return true;
+}
+
+void mgos_ssd1306_chart_push (struct mgos_ssd1306_widget *w, const int32_t *values) {
+  if (w == NULL || w->type != WIDGET_CHART || values == NULL)
+    return;
+
+  // values may come unaligned from the mJS FFI
+  memcpy (&w->samples[w->head * w->series], values, w->series * sizeof (*w->samples));
+  w->head = (w->head + 1) % w->slots;
+  if (w->count < w->slots)
+    w->count++;
+  if (!_chart_scroll (w))
+    _damage_bounds (w);
+}
+
+void mgos_ssd1306_bars_set_value (struct mgos_ssd1306_widget *w, uint16_t index, int32_t value) {
+  struct mgos_ssd1306 *oled;
+  uint16_t width, from, to;
+  int16_t clip[4], x;
+
+  if (w == NULL || w->type != WIDGET_BARS || index >= w->count || w->samples[index] == value)
+    return;
+
+  from = _bar_height (w, w->samples[index]);
+  to = _bar_height (w, value);
+  w->samples[index] = value;
+  if (from == to || !w->visible)
+    return;
+  if (!_in_place (w)) {
+    _bar_span (w, index, &x, &width);
+    _damage (w, x, (int32_t) w->y + w->h - (from > to ? from : to), (int32_t) x + width - 1, (int32_t) w->y + w->h - 1);
+    return;
+  }
+
+  // fill or clear the rows between the old and the new top, an inverting bar is
+  // cleared by inverting again
+  oled = w->oled;
+  clip[0] = oled->clip_left;
+  clip[1] = oled->clip_top;
+  clip[2] = oled->clip_right;
+  clip[3] = oled->clip_bottom;
+  _reset_clip (oled);
+  _bar_span (w, index, &x, &width);
+  if (to > from)
+    mgos_ssd1306_fill_rectangle (oled, x, (int32_t) w->y + w->h - to, width, to - from, w->foreground);
+  else
+    mgos_ssd1306_fill_rectangle (oled, x, (int32_t) w->y + w->h - from, width, from - to,
+                                 (w->foreground == SSD1306_COLOR_INVERT) ? SSD1306_COLOR_INVERT : _under (w));
+  oled->clip_left = clip[0];
+  oled->clip_top = clip[1];
+  oled->clip_right = clip[2];
+  oled->clip_bottom = clip[3];
+}
+
+void mgos_ssd1306_widgets_update (struct mgos_ssd1306 *oled) {
+  if (oled == NULL)
+    return;
+
+  if (oled->frame != NULL) {
+    mgos_ssd1306_clear (oled);
+    for (struct mgos_ssd1306_widget *w = oled->widgets; w != NULL; w = w->next) {
+      if (w->visible)
+        _draw (w);
+      w->damage_right = -1;
+    }
+  } else {
+    for (struct mgos_ssd1306_widget *w = oled->widgets; w != NULL; w = w->next) {
+      if (w->damage_right < w->damage_left)
+        continue;
+      _redraw (oled, w->damage_left, w->damage_top, w->damage_right, w->damage_bottom);
+      w->damage_left = 0;
+      w->damage_right = -1;
+    }
+  }
+  mgos_ssd1306_refresh (oled, false);
+}